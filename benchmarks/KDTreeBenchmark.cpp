@@ -0,0 +1,230 @@
+// KD树性能基准：比较每点一个节点与不同叶子桶大小下的构建、最近点和K近邻查询，
+// 串行与并行构建的耗时，逐个查询与批量查询的吞吐量，以及近似查询的延迟与召回率
+//
+// 用法：kdtree_benchmark [点数] [查询数]
+// 默认使用100万个均匀分布的随机点和20万次查询
+
+#include "algorithms/KDTree.h"
+#include "core/GeometryKernels.h"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+
+namespace {
+
+double secondsSince(std::chrono::steady_clock::time_point start) {
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+    int numPoints = (argc > 1) ? std::atoi(argv[1]) : 1000000;
+    int numQueries = (argc > 2) ? std::atoi(argv[2]) : 200000;
+    if (numPoints <= 0 || numQueries <= 0) {
+        std::cerr << "用法: " << argv[0] << " [点数] [查询数]" << std::endl;
+        return 1;
+    }
+    
+    std::mt19937 rng(42);
+    std::uniform_real_distribution<double> coordinate(0.0, 100000.0);
+    
+    std::vector<Point*> points;
+    points.reserve(numPoints);
+    for (int i = 0; i < numPoints; i++) {
+        points.push_back(new Point(i, coordinate(rng), coordinate(rng)));
+    }
+    
+    std::vector<double> queryXs(numQueries);
+    std::vector<double> queryYs(numQueries);
+    for (int i = 0; i < numQueries; i++) {
+        queryXs[i] = coordinate(rng);
+        queryYs[i] = coordinate(rng);
+    }
+    
+    std::cout << "点数 " << numPoints << "，查询数 " << numQueries
+              << "，AVX2 " << (GeometryKernels::usingAVX2() ? "开启" : "关闭") << std::endl;
+    std::cout << std::left << std::setw(10) << "桶大小"
+              << std::setw(12) << "构建(ms)"
+              << std::setw(12) << "内存(MB)"
+              << std::setw(14) << "最近点(ns)"
+              << std::setw(14) << "k=10(us)"
+              << std::setw(14) << "k=100(us)"
+              << "校验和" << std::endl;
+    
+    const int bucketSizes[] = {1, 8, 16, 32, 64};
+    std::vector<Point*> results(100);
+    
+    for (int bucketSize : bucketSizes) {
+        KDTree tree;
+        auto start = std::chrono::steady_clock::now();
+        tree.build(points, bucketSize);
+        double buildSeconds = secondsSince(start);
+    
+        // 校验和用于确认不同桶大小返回相同的结果
+        long long checksum = 0;
+    
+        start = std::chrono::steady_clock::now();
+        for (int i = 0; i < numQueries; i++) {
+            checksum += tree.findNearest(queryXs[i], queryYs[i])->getId();
+        }
+        double nearestSeconds = secondsSince(start);
+    
+        int knnQueries = numQueries / 10;
+        start = std::chrono::steady_clock::now();
+        for (int i = 0; i < knnQueries; i++) {
+            int count = tree.findKNearest(queryXs[i], queryYs[i], 10, results.data());
+            checksum += results[count - 1]->getId();
+        }
+        double knn10Seconds = secondsSince(start);
+    
+        start = std::chrono::steady_clock::now();
+        for (int i = 0; i < knnQueries; i++) {
+            int count = tree.findKNearest(queryXs[i], queryYs[i], 100, results.data());
+            checksum += results[count - 1]->getId();
+        }
+        double knn100Seconds = secondsSince(start);
+    
+        std::cout << std::left << std::fixed << std::setprecision(2)
+                  << std::setw(10) << bucketSize
+                  << std::setw(12) << buildSeconds * 1e3
+                  << std::setw(12) << tree.memoryUsage() / 1e6
+                  << std::setw(14) << nearestSeconds / numQueries * 1e9
+                  << std::setw(14) << knn10Seconds / knnQueries * 1e6
+                  << std::setw(14) << knn100Seconds / knnQueries * 1e6
+                  << checksum << std::endl;
+    }
+    
+    // 串行与并行构建的对比（默认桶大小）
+    {
+        KDTree serialTree;
+        auto start = std::chrono::steady_clock::now();
+        serialTree.build(points, KDTree::DEFAULT_BUCKET_SIZE, false);
+        double serialSeconds = secondsSince(start);
+    
+        KDTree parallelTree;
+        start = std::chrono::steady_clock::now();
+        parallelTree.build(points, KDTree::DEFAULT_BUCKET_SIZE, true);
+        double parallelSeconds = secondsSince(start);
+    
+        std::cout << "串行构建 " << serialSeconds * 1e3 << " ms，并行构建 " << parallelSeconds * 1e3
+                  << " ms（" << TaskPool::shared().getThreadCount() << " 线程）" << std::endl;
+    }
+    
+    // 批量K近邻：逐个查询与按 Morton 序批量查询（串行/并行）的吞吐量
+    {
+        KDTree tree;
+        tree.build(points);
+        const int k = 10;
+    
+        auto start = std::chrono::steady_clock::now();
+        long long checksum = 0;
+        for (int i = 0; i < numQueries; i++) {
+            int count = tree.findKNearest(queryXs[i], queryYs[i], k, results.data());
+            checksum += results[count - 1]->getId();
+        }
+        double singleSeconds = secondsSince(start);
+    
+        std::vector<size_t> offsets;
+        std::vector<Point*> batchResults;
+        double batchSeconds[2];
+        for (int parallel = 0; parallel < 2; parallel++) {
+            start = std::chrono::steady_clock::now();
+            tree.findKNearestBatch(queryXs.data(), queryYs.data(), numQueries, k, offsets, batchResults, parallel != 0);
+            batchSeconds[parallel] = secondsSince(start);
+        }
+    
+        long long batchChecksum = 0;
+        for (int i = 0; i < numQueries; i++) {
+            batchChecksum += batchResults[offsets[i + 1] - 1]->getId();
+        }
+    
+        std::cout << "k=10 吞吐量(万次/秒)：逐个查询 " << numQueries / singleSeconds / 1e4
+                  << "，批量串行 " << numQueries / batchSeconds[0] / 1e4
+                  << "，批量并行 " << numQueries / batchSeconds[1] / 1e4
+                  << "（" << TaskPool::shared().getThreadCount() << " 线程）"
+                  << (checksum == batchChecksum ? "" : "，结果不一致！") << std::endl;
+    }
+    
+    // 近似K近邻：不同 epsilon 和访问预算下的延迟与召回率（k=10，召回率为命中精确前10个的比例）
+    {
+        KDTree tree;
+        tree.build(points);
+        const int k = 10;
+        int approxQueries = numQueries / 10;
+    
+        std::vector<Point*> exact(static_cast<size_t>(approxQueries) * k);
+        for (int i = 0; i < approxQueries; i++) {
+            tree.findKNearest(queryXs[i], queryYs[i], k, exact.data() + static_cast<size_t>(i) * k);
+        }
+    
+        std::cout << std::left << std::setw(12) << "epsilon"
+                  << std::setw(12) << "节点预算"
+                  << std::setw(14) << "k=10(us)"
+                  << std::setw(12) << "召回率"
+                  << "最大距离比" << std::endl;
+    
+        const double epsilons[] = {0.0, 0.1, 0.5, 1.0, 2.0};
+        const int budgets[] = {0, 256, 128, 64};
+        std::vector<double> distances(k);
+        for (int budget : budgets) {
+            for (double epsilon : epsilons) {
+                if (budget > 0 && epsilon > 0.0) {
+                    continue; // 两种方式分别测量
+                }
+                KDTree::SearchOptions options;
+                options.epsilon = epsilon;
+                options.maxVisitedNodes = budget;
+    
+                std::vector<Point*> approx(exact.size());
+                auto start = std::chrono::steady_clock::now();
+                for (int i = 0; i < approxQueries; i++) {
+                    tree.findKNearest(queryXs[i], queryYs[i], k, options,
+                                      approx.data() + static_cast<size_t>(i) * k, distances.data());
+                }
+                double seconds = secondsSince(start);
+    
+                // 召回率与第K近距离相对精确值的最大比值
+                long long hits = 0;
+                double worstRatio = 1.0;
+                for (int i = 0; i < approxQueries; i++) {
+                    Point** expected = exact.data() + static_cast<size_t>(i) * k;
+                    Point** found = approx.data() + static_cast<size_t>(i) * k;
+                    for (int a = 0; a < k; a++) {
+                        for (int b = 0; b < k; b++) {
+                            if (found[a] == expected[b]) {
+                                hits++;
+                                break;
+                            }
+                        }
+                    }
+                    if (found[k - 1]) {
+                        double exactDist = std::hypot(expected[k - 1]->getX() - queryXs[i], expected[k - 1]->getY() - queryYs[i]);
+                        double foundDist = std::hypot(found[k - 1]->getX() - queryXs[i], found[k - 1]->getY() - queryYs[i]);
+                        if (exactDist > 0) {
+                            worstRatio = std::max(worstRatio, foundDist / exactDist);
+                        }
+                    }
+                }
+    
+                std::cout << std::left << std::fixed << std::setprecision(2)
+                          << std::setw(12) << epsilon
+                          << std::setw(12) << (budget > 0 ? std::to_string(budget) : std::string("-"))
+                          << std::setw(14) << seconds / approxQueries * 1e6
+                          << std::setw(12) << std::setprecision(4) << static_cast<double>(hits) / exact.size()
+                          << worstRatio << std::endl;
+            }
+        }
+    }
+    
+    for (Point* point : points) {
+        delete point;
+    }
+    return 0;
+}
@@ -0,0 +1,159 @@
+// 路网导入基准：测量 MapImporter 在不同解析线程数下的吞吐量和进程峰值内存
+//
+// 不给文件时先在临时目录生成一份 DIMACS 格式的网格路网（坐标带随机扰动，相邻点之间双向各一条弧），
+// 导入结束后删除；也可以直接导入已有的 DIMACS 或 CSV 文件。
+// 峰值内存是整个进程的峰值，多次导入时取到目前为止的最大值
+//
+// 用法：map_import_benchmark [点数]
+//       map_import_benchmark dimacs <图文件.gr> <坐标文件.co>
+//       map_import_benchmark csv <点文件> <边文件>
+// 默认生成100万个点的网格路网
+
+#include "algorithms/MapImporter.h"
+#include "core/Map.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace {
+
+// 生成网格路网时相邻点的间距
+constexpr double GRID_SPACING = 100.0;
+
+// 坐标扰动占间距的比例
+constexpr double GRID_JITTER = 0.3;
+
+// 写出约 side * side 个点的 DIMACS 网格路网，返回是否成功
+bool writeGridDimacs(int numPoints, const std::string& graphPath, const std::string& coordinatePath) {
+    const int side = std::max(2, static_cast<int>(std::ceil(std::sqrt(static_cast<double>(numPoints)))));
+    const long long numNodes = static_cast<long long>(side) * side;
+    const long long numArcs = 4LL * side * (side - 1); // 横竖各 side * (side - 1) 条道路，每条两个方向
+    
+    std::mt19937 rng(42);
+    std::uniform_real_distribution<double> jitter(-GRID_JITTER * GRID_SPACING, GRID_JITTER * GRID_SPACING);
+    
+    std::ofstream coordinates(coordinatePath);
+    std::ofstream graph(graphPath);
+    if (!coordinates || !graph) {
+        return false;
+    }
+    
+    coordinates << "c 网格路网坐标\np aux sp co " << numNodes << "\n";
+    for (int row = 0; row < side; row++) {
+        for (int column = 0; column < side; column++) {
+            long long id = static_cast<long long>(row) * side + column + 1;
+            coordinates << "v " << id << ' ' << static_cast<long long>(column * GRID_SPACING + jitter(rng))
+                        << ' ' << static_cast<long long>(row * GRID_SPACING + jitter(rng)) << '\n';
+        }
+    }
+    
+    graph << "c 网格路网\np sp " << numNodes << ' ' << numArcs << "\n";
+    auto writeRoad = [&graph](long long u, long long v) {
+        graph << "a " << u << ' ' << v << " 1\n"
+              << "a " << v << ' ' << u << " 1\n";
+    };
+    for (int row = 0; row < side; row++) {
+        for (int column = 0; column < side; column++) {
+            long long id = static_cast<long long>(row) * side + column + 1;
+            if (column + 1 < side) writeRoad(id, id + 1);
+            if (row + 1 < side) writeRoad(id, id + side);
+        }
+    }
+    
+    return static_cast<bool>(coordinates) && static_cast<bool>(graph);
+}
+
+void printStats(int numThreads, const ImportStats& stats) {
+    std::cout << std::left << std::setw(8) << numThreads
+              << std::setw(12) << stats.nodesImported
+              << std::setw(12) << stats.edgesImported
+              << std::setw(10) << stats.edgesSkipped
+              << std::setw(10) << stats.malformedLines
+              << std::fixed << std::setprecision(1)
+              << std::setw(12) << stats.bytesRead / (1024.0 * 1024.0)
+              << std::setprecision(3)
+              << std::setw(10) << stats.seconds
+              << std::setprecision(1)
+              << std::setw(12) << stats.megabytesPerSecond
+              << stats.peakMemoryBytes / (1024.0 * 1024.0)
+              << std::defaultfloat << std::endl;
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+    std::string format = "dimacs";
+    std::string firstPath;
+    std::string secondPath;
+    bool generated = false;
+    
+    if (argc == 4 && (std::string(argv[1]) == "dimacs" || std::string(argv[1]) == "csv")) {
+        format = argv[1];
+        firstPath = argv[2];
+        secondPath = argv[3];
+    } else if (argc <= 2) {
+        int numPoints = (argc > 1) ? std::atoi(argv[1]) : 1000000;
+        if (numPoints <= 0) {
+            std::cerr << "用法: " << argv[0] << " [点数] | dimacs <图文件> <坐标文件> | csv <点文件> <边文件>" << std::endl;
+            return 1;
+        }
+        std::filesystem::path directory = std::filesystem::temp_directory_path();
+        firstPath = (directory / "map_import_benchmark.gr").string();
+        secondPath = (directory / "map_import_benchmark.co").string();
+        std::cout << "生成网格路网（约 " << numPoints << " 个点）到 " << directory.string() << "..." << std::endl;
+        if (!writeGridDimacs(numPoints, firstPath, secondPath)) {
+            std::cerr << "无法写入临时文件" << std::endl;
+            return 1;
+        }
+        generated = true;
+    } else {
+        std::cerr << "用法: " << argv[0] << " [点数] | dimacs <图文件> <坐标文件> | csv <点文件> <边文件>" << std::endl;
+        return 1;
+    }
+    
+    // 单线程与所有硬件线程各导入一次，比较并行解析的加速
+    std::vector<int> threadCounts = {1};
+    int hardwareThreads = static_cast<int>(std::thread::hardware_concurrency());
+    if (hardwareThreads > 1) {
+        threadCounts.push_back(hardwareThreads);
+    }
+    
+    std::cout << std::left << std::setw(8) << "线程"
+              << std::setw(12) << "点数"
+              << std::setw(12) << "道路数"
+              << std::setw(10) << "跳过"
+              << std::setw(10) << "错误行"
+              << std::setw(12) << "读取(MB)"
+              << std::setw(10) << "耗时(s)"
+              << std::setw(12) << "MB/s"
+              << "峰值内存(MB)" << std::endl;
+    
+    int result = 0;
+    for (int numThreads : threadCounts) {
+        MapImporter importer(numThreads);
+        Map* map = (format == "csv") ? importer.importCsv(firstPath, secondPath)
+                                     : importer.importDimacs(firstPath, secondPath);
+        if (!map) {
+            std::cerr << "导入失败" << std::endl;
+            result = 1;
+            break;
+        }
+        printStats(numThreads, importer.getLastStats());
+        delete map;
+    }
+    
+    if (generated) {
+        std::remove(firstPath.c_str());
+        std::remove(secondPath.c_str());
+    }
+    return result;
+}
@@ -0,0 +1,286 @@
+// 路径搜索性能基准：比较随机编号与按 Hilbert 曲线重新编号后的最短路径查询耗时，
+// 以及 Dijkstra、A*、双向 Dijkstra 和收缩层次的确定点数和耗时；分别测量随机起终点的远途查询和起终点相邻的短途查询。
+// 最快路径的"收缩层次"一行使用按通行时间定制的可定制收缩层次，另外分别输出重算通行时间和重新定制一次的耗时。
+// 每种算法的路径代价（长度或行驶时间）逐个查询与 Dijkstra 比较，有不一致时返回非0
+//
+// 地图由均匀分布的随机点组成，每个点与最近的几个点相连；点按随机顺序创建，
+// ID与位置无关，模拟未经整理的导入数据。两张地图上执行同一批查询（起终点ID按映射换算），
+// 路径点数的校验和应当一致
+//
+// 用法：pathfinder_benchmark [点数] [查询数]
+// 默认使用20万个点和200次查询
+
+#include "algorithms/KDTree.h"
+#include "algorithms/PathFinder.h"
+#include "core/Map.h"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <vector>
+
+namespace {
+
+// 测量重新定制耗时的重复次数
+constexpr int CUSTOMIZATION_ROUNDS = 5;
+
+// 每个点连向的最近邻居数
+constexpr int NEIGHBORS_PER_POINT = 4;
+
+// 短途查询的终点取起点的第几个近邻
+constexpr int LOCAL_QUERY_RANK = 64;
+
+// 最快路径的通行时间参数，道路车辆数随机设置在容量附近，部分道路处于拥堵状态
+constexpr double TRAVEL_TIME_C = 1.0;
+constexpr double TRAVEL_TIME_THRESHOLD = 0.8;
+
+// 各算法路径代价与 Dijkstra 比较时允许的相对误差（不同的求和顺序会带来舍入差异）
+constexpr double COST_TOLERANCE = 1e-9;
+
+double secondsSince(std::chrono::steady_clock::time_point start) {
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+Map* buildRandomMap(int numPoints, std::mt19937& rng) {
+    std::uniform_real_distribution<double> coordinate(0.0, 100000.0);
+    
+    Map* map = new Map();
+    map->reserveCapacity(numPoints, static_cast<size_t>(numPoints) * NEIGHBORS_PER_POINT);
+    for (int i = 0; i < numPoints; i++) {
+        map->createPoint(coordinate(rng), coordinate(rng));
+    }
+    
+    KDTree tree;
+    std::vector<Point*> points = map->getAllPoints();
+    tree.build(points);
+    
+    Point* neighbors[NEIGHBORS_PER_POINT + 1];
+    for (Point* point : points) {
+        int found = tree.findKNearest(point->getX(), point->getY(), NEIGHBORS_PER_POINT + 1, neighbors);
+        for (int i = 0; i < found; i++) {
+            Point* neighbor = neighbors[i];
+            if (neighbor != point && !map->getRoadBetweenPoints(point->getId(), neighbor->getId())) {
+                map->createRoad(point, neighbor);
+            }
+        }
+    }
+    map->freezeTopology();
+    return map;
+}
+
+// 执行所有查询，返回平均耗时（微秒），路径点数累加到 checksum
+double runQueries(const PathFinder& finder, const std::vector<std::pair<int, int>>& queries, long long& checksum) {
+    auto start = std::chrono::steady_clock::now();
+    for (const auto& query : queries) {
+        checksum += static_cast<long long>(finder.findShortestPath(query.first, query.second).size());
+    }
+    return secondsSince(start) * 1e6 / queries.size();
+}
+
+// 把起终点ID换算到重新编号后的地图
+std::vector<std::pair<int, int>> remapQueries(const std::vector<std::pair<int, int>>& queries,
+                                              const std::vector<int>& newPointIds) {
+    std::vector<std::pair<int, int>> remapped(queries.size());
+    for (size_t i = 0; i < queries.size(); i++) {
+        remapped[i] = {newPointIds[queries[i].first], newPointIds[queries[i].second]};
+    }
+    return remapped;
+}
+
+// 在两张地图上执行同一批查询并输出耗时
+void compareNumberings(const char* label, const std::vector<std::pair<int, int>>& queries,
+                       const std::vector<std::pair<int, int>>& orderedQueries,
+                       const PathFinder& randomFinder, const PathFinder& orderedFinder) {
+    // 先各跑一遍预热，再依次计时
+    long long warmup = 0;
+    runQueries(randomFinder, queries, warmup);
+    runQueries(orderedFinder, orderedQueries, warmup);
+    
+    long long randomChecksum = 0;
+    long long orderedChecksum = 0;
+    double randomUs = runQueries(randomFinder, queries, randomChecksum);
+    double orderedUs = runQueries(orderedFinder, orderedQueries, orderedChecksum);
+    
+    std::cout << std::setw(10) << label << std::setw(12) << "随机" << std::setw(16) << std::setprecision(1)
+              << randomUs << randomChecksum << std::endl;
+    std::cout << std::setw(10) << label << std::setw(12) << "Hilbert" << std::setw(16) << orderedUs
+              << orderedChecksum << "（加速比 " << std::setprecision(2) << randomUs / orderedUs << "x）" << std::endl;
+}
+
+// 分别用各种搜索算法执行同一批最短/最快路径查询，输出平均确定点数和耗时（比例相对于 Dijkstra），
+// 并逐个查询把路径代价与 Dijkstra 比较，返回不一致的查询数
+int compareSearchModes(const char* label, const std::vector<std::pair<int, int>>& queries, Map* map) {
+    const SearchMode modes[] = {SearchMode::Dijkstra, SearchMode::AStar, SearchMode::Bidirectional,
+                                SearchMode::ContractionHierarchy};
+    const char* modeNames[] = {"Dijkstra", "A*", "双向", "收缩层次"};
+    const int numModes = 4;
+    
+    int totalMismatches = 0;
+    for (int fastest = 0; fastest <= 1; fastest++) {
+        double settled[numModes] = {0.0, 0.0, 0.0, 0.0};
+        double micros[numModes] = {0.0, 0.0, 0.0, 0.0};
+        int mismatches[numModes] = {0, 0, 0, 0};
+        std::vector<double> referenceCosts(queries.size());
+        std::vector<std::vector<Point*>> paths(queries.size());
+        for (int m = 0; m < numModes; m++) {
+            PathFinder finder(map);
+            finder.setSearchMode(modes[m]);
+            SearchStats stats;
+            auto start = std::chrono::steady_clock::now();
+            for (size_t q = 0; q < queries.size(); q++) {
+                if (fastest) {
+                    paths[q] = finder.findFastestPath(queries[q].first, queries[q].second, TRAVEL_TIME_C,
+                                                      TRAVEL_TIME_THRESHOLD, &stats);
+                } else {
+                    paths[q] = finder.findShortestPath(queries[q].first, queries[q].second, &stats);
+                }
+                settled[m] += stats.settledNodes;
+            }
+            micros[m] = secondsSince(start) * 1e6 / queries.size();
+            settled[m] /= queries.size();
+            
+            // 计时结束后再计算代价；不可达时代价记为-1
+            for (size_t q = 0; q < queries.size(); q++) {
+                double cost = -1.0;
+                if (!paths[q].empty()) {
+                    cost = fastest ? finder.calculatePathTravelTime(paths[q], TRAVEL_TIME_C, TRAVEL_TIME_THRESHOLD)
+                                   : finder.calculatePathLength(paths[q]);
+                }
+                if (m == 0) {
+                    referenceCosts[q] = cost;
+                } else if (std::fabs(cost - referenceCosts[q]) >
+                           COST_TOLERANCE * std::max(1.0, std::fabs(referenceCosts[q]))) {
+                    if (mismatches[m] == 0) {
+                        std::cerr << label << (fastest ? "最快" : "最短") << "路径：" << modeNames[m]
+                                  << " 与 Dijkstra 代价不一致，起点 " << queries[q].first << " 终点 "
+                                  << queries[q].second << "，" << std::setprecision(6) << cost << " != "
+                                  << referenceCosts[q] << std::endl;
+                    }
+                    mismatches[m]++;
+                }
+            }
+        }
+        for (int m = 0; m < numModes; m++) {
+            std::cout << std::setw(10) << label << std::setw(10) << (fastest ? "最快" : "最短")
+                      << std::setw(12) << modeNames[m] << std::setw(16) << std::setprecision(0) << settled[m]
+                      << std::setprecision(1) << micros[m];
+            if (m > 0) {
+                std::cout << "（确定点数 " << std::setprecision(2) << settled[m] / settled[0]
+                          << "x，耗时 " << micros[m] / micros[0] << "x）";
+                if (mismatches[m] > 0) {
+                    std::cout << " 代价不一致 " << mismatches[m] << " 次";
+                }
+            }
+            std::cout << std::endl;
+            totalMismatches += mismatches[m];
+        }
+    }
+    return totalMismatches;
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+    int numPoints = (argc > 1) ? std::atoi(argv[1]) : 200000;
+    int numQueries = (argc > 2) ? std::atoi(argv[2]) : 200;
+    if (numPoints <= 1 || numQueries <= 0) {
+        std::cerr << "用法: " << argv[0] << " [点数] [查询数]" << std::endl;
+        return 1;
+    }
+    
+    std::mt19937 rng(42);
+    auto start = std::chrono::steady_clock::now();
+    Map* randomMap = buildRandomMap(numPoints, rng);
+    std::cout << "点数 " << numPoints << "，道路数 " << randomMap->getNextRoadId()
+              << "，查询数 " << numQueries << "，生成 " << std::fixed << std::setprecision(1)
+              << secondsSince(start) * 1000.0 << " ms" << std::endl;
+    
+    start = std::chrono::steady_clock::now();
+    std::vector<int> newPointIds;
+    Map* orderedMap = randomMap->createSpatiallyOrdered(&newPointIds);
+    std::cout << "Hilbert 重新编号 " << secondsSince(start) * 1000.0 << " ms" << std::endl;
+    
+    // 远途：随机的起终点对；短途：终点为起点的第 LOCAL_QUERY_RANK 个近邻，只需搜索很小的范围
+    KDTree tree;
+    std::vector<Point*> points = randomMap->getAllPoints();
+    tree.build(points);
+    std::uniform_int_distribution<int> pointId(0, numPoints - 1);
+    std::vector<std::pair<int, int>> longQueries(numQueries);
+    std::vector<std::pair<int, int>> localQueries(numQueries);
+    std::vector<Point*> neighbors(LOCAL_QUERY_RANK);
+    for (int i = 0; i < numQueries; i++) {
+        longQueries[i] = {pointId(rng), pointId(rng)};
+        Point* origin = points[pointId(rng)];
+        int found = tree.findKNearest(origin->getX(), origin->getY(), LOCAL_QUERY_RANK, neighbors.data());
+        localQueries[i] = {origin->getId(), neighbors[found - 1]->getId()};
+    }
+    
+    PathFinder randomFinder(randomMap);
+    PathFinder orderedFinder(orderedMap);
+    
+    std::vector<std::pair<int, int>> orderedLongQueries = remapQueries(longQueries, newPointIds);
+    std::vector<std::pair<int, int>> orderedLocalQueries = remapQueries(localQueries, newPointIds);
+    
+    std::cout << std::left << std::setw(10) << "查询" << std::setw(12) << "编号"
+              << std::setw(16) << "每次查询(us)" << "校验和" << std::endl;
+    compareNumberings("远途", longQueries, orderedLongQueries, randomFinder, orderedFinder);
+    compareNumberings("短途", localQueries, orderedLocalQueries, randomFinder, orderedFinder);
+    
+    // 在重新编号后的地图上比较各种搜索算法
+    std::uniform_int_distribution<int> cars(0, 8);
+    for (Road* road : orderedMap->roadsView()) {
+        road->setCurrentCars(cars(rng));
+    }
+    orderedMap->updateTravelTimes(TRAVEL_TIME_C, TRAVEL_TIME_THRESHOLD);
+    
+    start = std::chrono::steady_clock::now();
+    orderedMap->rebuildContractionHierarchy();
+    const ContractionHierarchy* hierarchy = orderedMap->getContractionHierarchy();
+    std::cout << std::endl << "收缩层次预处理 " << std::setprecision(1) << secondsSince(start) * 1000.0
+              << " ms，捷径 " << hierarchy->getShortcutCount() << " 条，上行图 "
+              << hierarchy->memoryUsage() / (1024.0 * 1024.0) << " MB" << std::endl;
+    
+    start = std::chrono::steady_clock::now();
+    orderedMap->rebuildCustomizableHierarchy();
+    const CustomizableHierarchy* customizable = orderedMap->getCustomizableHierarchy();
+    std::cout << "可定制收缩层次预处理 " << secondsSince(start) * 1000.0 << " ms，上行边 "
+              << customizable->getArcCount() << " 条，" << customizable->getLevelCount() << " 层，占用 "
+              << customizable->memoryUsage() / (1024.0 * 1024.0) << " MB" << std::endl;
+    
+    // 每轮交通时段推进：随机改变车辆数并重算通行时间（模拟的每一步），
+    // 再由该时段的第一次最快路径查询触发定制，两部分分别计时
+    double recomputeMs = 0.0;
+    double customizeMs = 0.0;
+    for (int round = 0; round < CUSTOMIZATION_ROUNDS; round++) {
+        for (Road* road : orderedMap->roadsView()) {
+            road->setCurrentCars(cars(rng));
+        }
+        start = std::chrono::steady_clock::now();
+        orderedMap->updateTravelTimes(TRAVEL_TIME_C, TRAVEL_TIME_THRESHOLD);
+        recomputeMs += secondsSince(start) * 1000.0;
+        
+        start = std::chrono::steady_clock::now();
+        orderedMap->prepareCustomizableHierarchy(TRAVEL_TIME_C, TRAVEL_TIME_THRESHOLD);
+        customizeMs += secondsSince(start) * 1000.0;
+    }
+    std::cout << "重算通行时间 " << recomputeMs / CUSTOMIZATION_ROUNDS << " ms，首次查询时定制 "
+              << customizeMs / CUSTOMIZATION_ROUNDS << " ms（" << CUSTOMIZATION_ROUNDS << " 轮平均）" << std::endl;
+    
+    std::cout << std::setw(10) << "查询" << std::setw(10) << "路径" << std::setw(12) << "算法"
+              << std::setw(16) << "确定点数" << "每次查询(us)" << std::endl;
+    int mismatches = compareSearchModes("远途", orderedLongQueries, orderedMap);
+    mismatches += compareSearchModes("短途", orderedLocalQueries, orderedMap);
+    
+    delete orderedMap;
+    delete randomMap;
+    
+    if (mismatches > 0) {
+        std::cerr << "共有 " << mismatches << " 次查询的路径代价与 Dijkstra 不一致" << std::endl;
+        return 1;
+    }
+    std::cout << "所有算法的路径代价与 Dijkstra 一致" << std::endl;
+    return 0;
+}
@@ -0,0 +1,454 @@
+#include "ContractionHierarchy.h"
+#include "SearchWorkspace.h"
+#include "../core/TaskPool.h"
+#include <algorithm>
+#include <functional>
+#include <limits>
+
+namespace {
+
+// 收缩过程中动态图的边，两端各存一份
+struct Arc {
+    int target;
+    double weight;
+    int middle;     // 捷径绕过的点，原始道路为-1
+};
+
+struct Shortcut {
+    int from;
+    int to;
+    double weight;
+    int middle;
+};
+
+// 在 arcs 中加入到 target 的边；已有边时保留较短的一条
+void addOrImproveArc(std::vector<Arc>& arcs, int target, double weight, int middle) {
+    for (Arc& arc : arcs) {
+        if (arc.target == target) {
+            if (weight < arc.weight) {
+                arc.weight = weight;
+                arc.middle = middle;
+            }
+            return;
+        }
+    }
+    arcs.push_back(Arc{target, weight, middle});
+}
+
+void removeArc(std::vector<Arc>& arcs, int target) {
+    for (size_t i = 0; i < arcs.size(); i++) {
+        if (arcs[i].target == target) {
+            arcs[i] = arcs.back();
+            arcs.pop_back();
+            return;
+        }
+    }
+}
+
+// 收缩 node 所需的捷径：对每对邻居 (u, x)，在不经过 node 和已收缩点的剩余图中，
+// 找不到不长于 w(u, node) + w(node, x) 的路径时需要一条捷径；每次搜索最多确定 settleLimit 个点。
+// 只读访问 graph 和 contracted，可以在多个线程上同时调用
+void findShortcuts(const std::vector<std::vector<Arc>>& graph, const std::vector<char>& contracted,
+                   int node, std::vector<Shortcut>& shortcuts, int settleLimit) {
+    const std::vector<Arc>& neighbors = graph[node];
+    
+    SearchWorkspace& workspace = SearchWorkspace::forCurrentThread();
+    for (size_t i = 0; i + 1 < neighbors.size(); i++) {
+        const Arc& in = neighbors[i];
+    
+        // 从 u 出发的见证搜索：超过经过 node 到后面各邻居的最长路线，或这些邻居都已确定时停止
+        double maxOutWeight = 0.0;
+        for (size_t j = i + 1; j < neighbors.size(); j++) {
+            maxOutWeight = std::max(maxOutWeight, neighbors[j].weight);
+        }
+        double limit = in.weight + maxOutWeight;
+        size_t targetsLeft = neighbors.size() - i - 1;
+        workspace.begin(graph.size());
+        workspace.relax(in.target, 0.0, -1);
+    
+        int settled = 0;
+        int current;
+        double currentCost;
+        while (targetsLeft > 0 && settled < settleLimit &&
+               workspace.popMin(current, currentCost)) {
+            if (currentCost > limit) {
+                break;
+            }
+            workspace.settle(current);
+            settled++;
+            for (size_t j = i + 1; j < neighbors.size(); j++) {
+                if (neighbors[j].target == current) {
+                    targetsLeft--;
+                    break;
+                }
+            }
+            for (const Arc& arc : graph[current]) {
+                if (arc.target == node || contracted[arc.target]) {
+                    continue;
+                }
+                double newCost = currentCost + arc.weight;
+                if (newCost <= limit) {
+                    workspace.relax(arc.target, newCost, current);
+                }
+            }
+        }
+    
+        // 每对邻居只检查一次，捷径在两端都会加入
+        for (size_t j = i + 1; j < neighbors.size(); j++) {
+            const Arc& out = neighbors[j];
+            double viaCost = in.weight + out.weight;
+            if (workspace.cost(out.target) > viaCost) {
+                shortcuts.push_back(Shortcut{in.target, out.target, viaCost, node});
+            }
+        }
+    }
+}
+
+} // namespace
+
+ContractionHierarchy::ContractionHierarchy() : upOffsets(1, 0), numShortcuts(0) {
+}
+
+void ContractionHierarchy::clear() {
+    upOffsets.assign(1, 0);
+    upTargets.clear();
+    upWeights.clear();
+    upMiddles.clear();
+    ranks.clear();
+    numShortcuts = 0;
+}
+
+void ContractionHierarchy::build(size_t numNodes, const std::vector<Edge>& edges, bool parallel) {
+    clear();
+    if (numNodes == 0) {
+        return;
+    }
+    const int n = static_cast<int>(numNodes);
+    
+    // 动态图：重复道路只保留最短的一条，去掉自环
+    std::vector<std::vector<Arc>> graph(numNodes);
+    for (const Edge& edge : edges) {
+        if (edge.from == edge.to || edge.from < 0 || edge.to < 0 || edge.from >= n || edge.to >= n) {
+            continue;
+        }
+        addOrImproveArc(graph[edge.from], edge.to, edge.weight, -1);
+        addOrImproveArc(graph[edge.to], edge.from, edge.weight, -1);
+    }
+    
+    std::vector<char> contracted(numNodes, 0);
+    std::vector<int> deletedNeighbors(numNodes, 0);
+    std::vector<int> levels(numNodes, 0);
+    std::vector<double> priorities(numNodes, 0.0);
+    std::vector<std::vector<Arc>> upArcs(numNodes);
+    ranks.assign(numNodes, -1);
+    
+    TaskPool& pool = TaskPool::shared();
+    auto forEachParallel = [&](size_t count, const std::function<void(size_t, size_t)>& body) {
+        if (parallel && pool.getThreadCount() > 1) {
+            pool.parallelFor(0, count, CONTRACTION_GRAIN, body);
+        } else {
+            body(0, count);
+        }
+    };
+    
+    // 优先级：两倍的边差，加上已收缩的邻居数和层级深度，后两项让收缩在图中分布得更均匀、层级更浅。
+    // 估计时只需要捷径数，多估的捷径只影响收缩顺序
+    auto updatePriorities = [&](const std::vector<int>& nodes) {
+        forEachParallel(nodes.size(), [&](size_t begin, size_t end) {
+            std::vector<Shortcut> shortcuts;
+            for (size_t i = begin; i < end; i++) {
+                int node = nodes[i];
+                shortcuts.clear();
+                findShortcuts(graph, contracted, node, shortcuts, PRIORITY_SETTLE_LIMIT);
+                double edgeDifference = static_cast<double>(shortcuts.size()) - static_cast<double>(graph[node].size());
+                priorities[node] = 2.0 * edgeDifference + deletedNeighbors[node] + levels[node];
+            }
+        });
+    };
+    
+    std::vector<int> remaining(numNodes);
+    for (int i = 0; i < n; i++) {
+        remaining[i] = i;
+    }
+    updatePriorities(remaining);
+    
+    int nextRank = 0;
+    std::vector<int> selected;
+    std::vector<std::vector<Shortcut>> roundShortcuts;
+    std::vector<int> touched;
+    std::vector<char> touchedMark(numNodes, 0);
+    
+    while (!remaining.empty()) {
+        // 选出 (优先级, 下标) 小于所有邻居的点，它们互不相邻；全局最小的点总会被选中
+        selected.clear();
+        for (int node : remaining) {
+            bool isLocalMinimum = true;
+            for (const Arc& arc : graph[node]) {
+                int other = arc.target;
+                if (priorities[other] < priorities[node] ||
+                    (priorities[other] == priorities[node] && other < node)) {
+                    isLocalMinimum = false;
+                    break;
+                }
+            }
+            if (isLocalMinimum) {
+                selected.push_back(node);
+            }
+        }
+    
+        // 同一轮的点互相视为已删除，见证路径只经过剩余的点
+        for (int node : selected) {
+            contracted[node] = 1;
+        }
+    
+        // 并行见证搜索
+        roundShortcuts.assign(selected.size(), std::vector<Shortcut>());
+        forEachParallel(selected.size(), [&](size_t begin, size_t end) {
+            for (size_t i = begin; i < end; i++) {
+                findShortcuts(graph, contracted, selected[i], roundShortcuts[i], WITNESS_SETTLE_LIMIT);
+            }
+        });
+    
+        // 串行地删除这些点并加入捷径；删除时剩下的邻居层级都更高，正是它的上行边
+        touched.clear();
+        for (size_t i = 0; i < selected.size(); i++) {
+            int node = selected[i];
+            ranks[node] = nextRank++;
+            for (const Arc& arc : graph[node]) {
+                removeArc(graph[arc.target], node);
+                deletedNeighbors[arc.target]++;
+                levels[arc.target] = std::max(levels[arc.target], levels[node] + 1);
+                if (!touchedMark[arc.target]) {
+                    touchedMark[arc.target] = 1;
+                    touched.push_back(arc.target);
+                }
+            }
+            upArcs[node].swap(graph[node]);
+    
+            for (const Shortcut& shortcut : roundShortcuts[i]) {
+                addOrImproveArc(graph[shortcut.from], shortcut.to, shortcut.weight, shortcut.middle);
+                addOrImproveArc(graph[shortcut.to], shortcut.from, shortcut.weight, shortcut.middle);
+            }
+        }
+    
+        // 邻居的度数和周围的见证路径都变了，重新计算它们的优先级
+        for (int node : touched) {
+            touchedMark[node] = 0;
+        }
+        updatePriorities(touched);
+    
+        remaining.erase(std::remove_if(remaining.begin(), remaining.end(),
+                                       [&contracted](int node) { return contracted[node] != 0; }),
+                        remaining.end());
+    }
+    
+    // 把各点的上行边整理成CSR
+    upOffsets.assign(numNodes + 1, 0);
+    for (int node = 0; node < n; node++) {
+        upOffsets[node + 1] = upOffsets[node] + static_cast<int>(upArcs[node].size());
+    }
+    upTargets.resize(upOffsets.back());
+    upWeights.resize(upOffsets.back());
+    upMiddles.resize(upOffsets.back());
+    for (int node = 0; node < n; node++) {
+        int k = upOffsets[node];
+        for (const Arc& arc : upArcs[node]) {
+            upTargets[k] = arc.target;
+            upWeights[k] = arc.weight;
+            upMiddles[k] = arc.middle;
+            if (arc.middle >= 0) {
+                numShortcuts++;
+            }
+            k++;
+        }
+    }
+}
+
+int ContractionHierarchy::findEdge(int a, int b) const {
+    int lower = (ranks[a] < ranks[b]) ? a : b;
+    int higher = (lower == a) ? b : a;
+    for (int k = upOffsets[lower]; k < upOffsets[lower + 1]; k++) {
+        if (upTargets[k] == higher) {
+            return k;
+        }
+    }
+    return -1;
+}
+
+void ContractionHierarchy::unpackEdge(int from, int to, std::vector<int>& path) const {
+    // 用显式栈展开，嵌套深度与层级数有关
+    std::vector<std::pair<int, int>> stack;
+    stack.emplace_back(from, to);
+    while (!stack.empty()) {
+        std::pair<int, int> segment = stack.back();
+        stack.pop_back();
+        int edge = findEdge(segment.first, segment.second);
+        int middle = (edge >= 0) ? upMiddles[edge] : -1;
+        if (middle < 0) {
+            path.push_back(segment.second);
+        } else {
+            // 先展开前半段：后压入的先处理
+            stack.emplace_back(middle, segment.second);
+            stack.emplace_back(segment.first, middle);
+        }
+    }
+}
+
+double ContractionHierarchy::query(int source, int target, std::vector<int>* path, size_t* settledNodes) const {
+    const double infinity = std::numeric_limits<double>::infinity();
+    if (path) {
+        path->clear();
+    }
+    if (settledNodes) {
+        *settledNodes = 0;
+    }
+    const int n = static_cast<int>(ranks.size());
+    if (source < 0 || target < 0 || source >= n || target >= n) {
+        return infinity;
+    }
+    
+    SearchWorkspace& forward = SearchWorkspace::forCurrentThread(0);
+    SearchWorkspace& backward = SearchWorkspace::forCurrentThread(1);
+    forward.begin(ranks.size());
+    backward.begin(ranks.size());
+    forward.relax(source, 0.0, -1);
+    backward.relax(target, 0.0, -1);
+    
+    double bestCost = (source == target) ? 0.0 : infinity;
+    int meeting = (source == target) ? source : -1;
+    size_t settledCount = 0;
+    
+    for (;;) {
+        double forwardTop = forward.minPriority();
+        double backwardTop = backward.minPriority();
+    
+        // 两侧都只向上搜索，一侧堆顶不小于最佳代价时这一侧已不可能改进结果
+        if (std::min(forwardTop, backwardTop) >= bestCost) {
+            break;
+        }
+    
+        bool expandForward = forwardTop <= backwardTop;
+        SearchWorkspace& side = expandForward ? forward : backward;
+        SearchWorkspace& other = expandForward ? backward : forward;
+    
+        int current;
+        double currentCost;
+        side.popMin(current, currentCost);
+        side.settle(current);
+        settledCount++;
+    
+        // 按需停滞：某个更高层的点经一条边到达 current 更近，说明 current 不在最短的上行路径上，
+        // 从它出发的扩展都是多余的
+        bool stalled = false;
+        for (int k = upOffsets[current]; k < upOffsets[current + 1]; k++) {
+            if (side.cost(upTargets[k]) + upWeights[k] < currentCost) {
+                stalled = true;
+                break;
+            }
+        }
+        if (stalled) {
+            continue;
+        }
+    
+        for (int k = upOffsets[current]; k < upOffsets[current + 1]; k++) {
+            int next = upTargets[k];
+            double newCost = currentCost + upWeights[k];
+            if (side.relax(next, newCost, current) && other.isReached(next) &&
+                newCost + other.cost(next) < bestCost) {
+                bestCost = newCost + other.cost(next);
+                meeting = next;
+            }
+        }
+    }
+    
+    if (settledNodes) {
+        *settledNodes = settledCount;
+    }
+    if (meeting < 0) {
+        return infinity;
+    }
+    
+    if (path) {
+        // 上行图中的路径：起点到相遇点，再从相遇点沿反向前驱到终点
+        std::vector<int> upPath;
+        for (int at = meeting; at != -1; at = forward.previous(at)) {
+            upPath.push_back(at);
+        }
+        std::reverse(upPath.begin(), upPath.end());
+        for (int at = backward.previous(meeting); at != -1; at = backward.previous(at)) {
+            upPath.push_back(at);
+        }
+    
+        // 逐条展开捷径
+        path->push_back(upPath.front());
+        for (size_t i = 1; i < upPath.size(); i++) {
+            unpackEdge(upPath[i - 1], upPath[i], *path);
+        }
+    }
+    return bestCost;
+}
+
+size_t ContractionHierarchy::memoryUsage() const {
+    return (upOffsets.capacity() + upTargets.capacity() + upMiddles.capacity() + ranks.capacity()) * sizeof(int) +
+           upWeights.capacity() * sizeof(double);
+}
+
+void ContractionHierarchy::exportLayout(std::vector<int>& outRanks, std::vector<int>& outOffsets,
+                                        std::vector<int>& outTargets, std::vector<double>& outWeights,
+                                        std::vector<int>& outMiddles) const {
+    outRanks = ranks;
+    outOffsets = upOffsets;
+    outTargets = upTargets;
+    outWeights = upWeights;
+    outMiddles = upMiddles;
+}
+
+bool ContractionHierarchy::buildFromLayout(const std::vector<int>& newRanks, const std::vector<int>& newOffsets,
+                                           const std::vector<int>& newTargets, const std::vector<double>& newWeights,
+                                           const std::vector<int>& newMiddles) {
+    clear();
+    const int n = static_cast<int>(newRanks.size());
+    const size_t numArcs = newTargets.size();
+    if (newOffsets.size() != newRanks.size() + 1 || newWeights.size() != numArcs || newMiddles.size() != numArcs ||
+        newOffsets.front() != 0 || static_cast<size_t>(newOffsets.back()) != numArcs) {
+        return false;
+    }
+    
+    // 层级须是一个排列
+    std::vector<char> seen(n, 0);
+    for (int rank : newRanks) {
+        if (rank < 0 || rank >= n || seen[rank]) {
+            return false;
+        }
+        seen[rank] = 1;
+    }
+    
+    // 上行边指向层级更高的点，捷径绕过的点层级更低，保证查询和展开都能结束
+    size_t shortcuts = 0;
+    for (int node = 0; node < n; node++) {
+        if (newOffsets[node] > newOffsets[node + 1]) {
+            return false;
+        }
+        for (int k = newOffsets[node]; k < newOffsets[node + 1]; k++) {
+            int target = newTargets[k];
+            int middle = newMiddles[k];
+            if (target < 0 || target >= n || newRanks[target] <= newRanks[node] || !(newWeights[k] >= 0.0)) {
+                return false;
+            }
+            if (middle != -1) {
+                if (middle < 0 || middle >= n || newRanks[middle] >= newRanks[node]) {
+                    return false;
+                }
+                shortcuts++;
+            }
+        }
+    }
+    
+    ranks = newRanks;
+    upOffsets = newOffsets;
+    upTargets = newTargets;
+    upWeights = newWeights;
+    upMiddles = newMiddles;
+    numShortcuts = shortcuts;
+    return true;
+}
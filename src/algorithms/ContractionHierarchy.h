@@ -0,0 +1,80 @@
+#ifndef CONTRACTION_HIERARCHY_H
+#define CONTRACTION_HIERARCHY_H
+
+#include <vector>
+#include <cstddef>
+
+// 收缩层次(Contraction Hierarchies)：按道路长度预处理后，点到点最短路查询只需在很小的上行图中搜索
+//
+// 预处理按优先级逐个"收缩"点：删除该点，并在它的邻居之间补上捷径，使剩余图中的距离保持不变；
+// 若邻居之间存在不经过该点、且不长于经过该点的路径（见证路径），则不需要捷径。
+// 优先级由边差（新增捷径数 - 删除的边数）、已收缩的邻居数和层级深度组成。每一轮选出优先级低于
+// 所有邻居的点，它们互不相邻，可以在线程池上并行做见证搜索，再串行地把捷径加入图中。
+//
+// 查询从起点和终点同时向层级更高的点搜索（带按需停滞），两侧相遇处即为最短路径的最高点；
+// 结果中的捷径按其绕过的点递归展开回原图中的点序列。点和边都以稠密索引表示
+class ContractionHierarchy {
+public:
+    // 预处理的输入边（无向）
+    struct Edge {
+        int from;
+        int to;
+        double weight;
+    };
+    
+    // 见证搜索最多确定的点数，超过时按没有见证路径处理（多加一条捷径，不影响正确性）
+    static constexpr int WITNESS_SETTLE_LIMIT = 256;
+    
+    // 估计优先级时见证搜索最多确定的点数；每轮都要为收缩点的所有邻居重新估计，用较小的上限
+    static constexpr int PRIORITY_SETTLE_LIMIT = 16;
+    
+    // 并行见证搜索时每个任务至少处理的点数
+    static constexpr int CONTRACTION_GRAIN = 64;
+
+private:
+    // 上行图（CSR）：点u的上行边位于 [upOffsets[u], upOffsets[u + 1])，都指向层级更高的点
+    std::vector<int> upOffsets;
+    std::vector<int> upTargets;
+    std::vector<double> upWeights;
+    std::vector<int> upMiddles;     // 捷径绕过的点，原始道路为-1
+    
+    // 每个点的收缩顺序（层级）
+    std::vector<int> ranks;
+    
+    size_t numShortcuts;
+    
+    // 连接 a、b 两点的上行边下标（存放在层级较低的一端），不存在时返回-1
+    int findEdge(int a, int b) const;
+    
+    // 把边 (from, to) 展开成原图中的点序列，追加到 path 末尾（不含 from）
+    void unpackEdge(int from, int to, std::vector<int>& path) const;
+
+public:
+    ContractionHierarchy();
+    
+    // 对 numNodes 个点和给定的无向边做预处理；parallel 为 true 时见证搜索在共享线程池上并行
+    void build(size_t numNodes, const std::vector<Edge>& edges, bool parallel = true);
+    
+    void clear();
+    bool empty() const { return ranks.empty(); }
+    size_t getNodeCount() const { return ranks.size(); }
+    size_t getShortcutCount() const { return numShortcuts; }
+    int getRank(int node) const { return ranks[node]; }
+    
+    // source 到 target 的最短距离，不可达时为无穷大。
+    // path 不为空时写入途经点的稠密索引（含起终点，不可达时为空）；settledNodes 不为空时写入确定的点数
+    double query(int source, int target, std::vector<int>* path = nullptr, size_t* settledNodes = nullptr) const;
+    
+    // 上行图占用的字节数（不含 vector 对象本身）
+    size_t memoryUsage() const;
+    
+    // 导出/导入预处理结果：每个点的层级和上行图（CSR），导出和导入都是线性拷贝。
+    // 用于把收缩层次保存到地图文件中，加载时无需重新收缩；导入的数据不一致时返回 false 并保持为空
+    void exportLayout(std::vector<int>& outRanks, std::vector<int>& outOffsets, std::vector<int>& outTargets,
+                      std::vector<double>& outWeights, std::vector<int>& outMiddles) const;
+    bool buildFromLayout(const std::vector<int>& newRanks, const std::vector<int>& newOffsets,
+                         const std::vector<int>& newTargets, const std::vector<double>& newWeights,
+                         const std::vector<int>& newMiddles);
+};
+
+#endif // CONTRACTION_HIERARCHY_H
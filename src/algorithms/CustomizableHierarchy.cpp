@@ -0,0 +1,557 @@
+#include "CustomizableHierarchy.h"
+#include "SearchWorkspace.h"
+#include "../core/TaskPool.h"
+#include <algorithm>
+#include <limits>
+#include <mutex>
+#include <utility>
+
+namespace {
+
+// 按坐标的嵌套剖分
+//
+// order[begin, end) 是一个待剖分的子图，它最终占据层级区间 [begin, end)。labels 标记每个点所属的子图，
+// 分隔点为-1；二分时两侧分别标记为 begin 和 mid，都在本区间内，与其他子图的标记不会相同，
+// 判断邻居在哪一侧只需比较标记
+class NestedDissection {
+private:
+    const double* xs;
+    const double* ys;
+    const std::vector<int>& offsets;
+    const std::vector<int>& neighbors;
+    std::vector<int> labels;
+    std::vector<char> inSeparator;
+    
+    // 二分图匹配：被切断的边两端点的配对点，以及增广搜索的访问标记
+    std::vector<int> mates;
+    std::vector<int> visits;
+    int visitStamp;
+    
+    // 从左侧点 node 出发沿交错路寻找增广路，找到时沿路翻转匹配
+    bool augment(int node, int rightLabel) {
+        for (int k = offsets[node]; k < offsets[node + 1]; k++) {
+            int next = neighbors[k];
+            if (labels[next] != rightLabel || visits[next] == visitStamp) {
+                continue;
+            }
+            visits[next] = visitStamp;
+            if (mates[next] < 0 || augment(mates[next], rightLabel)) {
+                mates[next] = node;
+                mates[node] = next;
+                return true;
+            }
+        }
+        return false;
+    }
+    
+    // 沿方向 (dx, dy) 把 order[begin, end) 在中位数处二分，并以被切断的边的最小点覆盖作为分隔点：
+    // 二分图中最大匹配后，从左侧未匹配点沿交错路可达的集合为Z，覆盖为 (左侧 \ Z) ∪ (右侧 ∩ Z)（König定理）。
+    // 写入 inSeparator，返回分隔点数
+    int split(int begin, int mid, int end, double dx, double dy) {
+        std::nth_element(order.begin() + begin, order.begin() + mid, order.begin() + end, [this, dx, dy](int a, int b) {
+            return dx * xs[a] + dy * ys[a] < dx * xs[b] + dy * ys[b];
+        });
+        for (int i = begin; i < end; i++) {
+            labels[order[i]] = (i < mid) ? begin : mid;
+            mates[order[i]] = -1;
+            inSeparator[order[i]] = 0;
+        }
+        
+        // 左侧的边界点逐个寻找增广路
+        std::vector<int> leftBoundary;
+        for (int i = begin; i < mid; i++) {
+            int node = order[i];
+            bool onBoundary = false;
+            for (int k = offsets[node]; k < offsets[node + 1] && !onBoundary; k++) {
+                onBoundary = labels[neighbors[k]] == mid;
+            }
+            if (onBoundary) {
+                leftBoundary.push_back(node);
+                visitStamp++;
+                augment(node, mid);
+            }
+        }
+        
+        // 从左侧未匹配的边界点出发标记Z：左到右走任意切断边，右到左走匹配边
+        visitStamp++;
+        std::vector<int> stack;
+        for (int node : leftBoundary) {
+            if (mates[node] < 0) {
+                visits[node] = visitStamp;
+                stack.push_back(node);
+            }
+        }
+        while (!stack.empty()) {
+            int node = stack.back();
+            stack.pop_back();
+            for (int k = offsets[node]; k < offsets[node + 1]; k++) {
+                int next = neighbors[k];
+                if (labels[next] != mid || visits[next] == visitStamp) {
+                    continue;
+                }
+                visits[next] = visitStamp;
+                int mate = mates[next];
+                if (mate >= 0 && visits[mate] != visitStamp) {
+                    visits[mate] = visitStamp;
+                    stack.push_back(mate);
+                }
+            }
+        }
+        
+        // 每条匹配边恰好贡献一个覆盖点
+        int separatorSize = 0;
+        for (int node : leftBoundary) {
+            int mate = mates[node];
+            if (mate < 0) {
+                continue;
+            }
+            int cover = (visits[node] == visitStamp) ? mate : node;
+            inSeparator[cover] = 1;
+            separatorSize++;
+        }
+        return separatorSize;
+    }
+    
+public:
+    std::vector<int> order;
+    
+    NestedDissection(size_t numNodes, const double* xs, const double* ys,
+                     const std::vector<int>& offsets, const std::vector<int>& neighbors)
+        : xs(xs), ys(ys), offsets(offsets), neighbors(neighbors), labels(numNodes, 0),
+          inSeparator(numNodes, 0), mates(numNodes, -1), visits(numNodes, 0), visitStamp(0), order(numNodes) {
+        for (size_t i = 0; i < numNodes; i++) {
+            order[i] = static_cast<int>(i);
+        }
+    }
+    
+    void run(int leafSize) {
+        std::vector<std::pair<int, int>> pending;
+        pending.emplace_back(0, static_cast<int>(order.size()));
+        while (!pending.empty()) {
+            int begin = pending.back().first;
+            int end = pending.back().second;
+            pending.pop_back();
+            if (end - begin <= leafSize) {
+                continue;
+            }
+    
+            // 分别沿横、纵和两条对角线方向二分，取分隔点最少的方向
+            const double directions[4][2] = {{1.0, 0.0}, {0.0, 1.0}, {1.0, 1.0}, {1.0, -1.0}};
+            int mid = begin + (end - begin) / 2;
+            int bestDirection = 0;
+            int bestSize = -1;
+            for (int direction = 0; direction < 4; direction++) {
+                int size = split(begin, mid, end, directions[direction][0], directions[direction][1]);
+                if (bestSize < 0 || size < bestSize) {
+                    bestSize = size;
+                    bestDirection = direction;
+                }
+            }
+            if (bestDirection != 3) {
+                split(begin, mid, end, directions[bestDirection][0], directions[bestDirection][1]);
+            }
+    
+            // 重排为 [左侧, 右侧, 分隔点]，分隔点得到区间内最高的层级
+            std::vector<int> left, right, separator;
+            for (int i = begin; i < end; i++) {
+                int node = order[i];
+                if (inSeparator[node]) {
+                    labels[node] = -1;
+                    separator.push_back(node);
+                } else if (i < mid) {
+                    left.push_back(node);
+                } else {
+                    right.push_back(node);
+                }
+            }
+            int cursor = begin;
+            for (int node : left) {
+                order[cursor++] = node;
+            }
+            int rightBegin = cursor;
+            for (int node : right) {
+                order[cursor++] = node;
+            }
+            int separatorBegin = cursor;
+            for (int node : separator) {
+                order[cursor++] = node;
+            }
+    
+            // 两侧作为新的子图继续剖分，它们的点仍带着各自的标记
+            pending.emplace_back(begin, rightBegin);
+            pending.emplace_back(rightBegin, separatorBegin);
+        }
+    }
+};
+
+} // namespace
+
+CustomizableHierarchy::CustomizableHierarchy() : upOffsets(1, 0), downOffsets(1, 0), customized(false) {
+}
+
+void CustomizableHierarchy::clear() {
+    order.clear();
+    ranks.clear();
+    parents.clear();
+    upOffsets.assign(1, 0);
+    upTargets.clear();
+    upWeights.clear();
+    upMiddles.clear();
+    downOffsets.assign(1, 0);
+    downSources.clear();
+    downArcs.clear();
+    levelOffsets.clear();
+    levelNodes.clear();
+    inputArcs.clear();
+    customized = false;
+}
+
+void CustomizableHierarchy::computeOrder(size_t numNodes, const std::vector<Edge>& edges,
+                                         const double* xs, const double* ys) {
+    const int n = static_cast<int>(numNodes);
+    
+    // 输入图的邻接表（CSR）
+    std::vector<int> offsets(numNodes + 1, 0);
+    for (const Edge& edge : edges) {
+        if (edge.from != edge.to && edge.from >= 0 && edge.to >= 0 && edge.from < n && edge.to < n) {
+            offsets[edge.from + 1]++;
+            offsets[edge.to + 1]++;
+        }
+    }
+    for (size_t i = 0; i < numNodes; i++) {
+        offsets[i + 1] += offsets[i];
+    }
+    std::vector<int> neighbors(offsets.back());
+    std::vector<int> cursor(offsets.begin(), offsets.end() - 1);
+    for (const Edge& edge : edges) {
+        if (edge.from != edge.to && edge.from >= 0 && edge.to >= 0 && edge.from < n && edge.to < n) {
+            neighbors[cursor[edge.from]++] = edge.to;
+            neighbors[cursor[edge.to]++] = edge.from;
+        }
+    }
+    
+    NestedDissection dissection(numNodes, xs, ys, offsets, neighbors);
+    dissection.run(DISSECTION_LEAF_SIZE);
+    order.swap(dissection.order);
+    ranks.assign(numNodes, -1);
+    for (int i = 0; i < n; i++) {
+        ranks[order[i]] = i;
+    }
+}
+
+void CustomizableHierarchy::build(size_t numNodes, const std::vector<Edge>& edges, const double* xs, const double* ys) {
+    clear();
+    if (numNodes == 0) {
+        return;
+    }
+    const int n = static_cast<int>(numNodes);
+    computeOrder(numNodes, edges, xs, ys);
+    
+    // 符号收缩：按层级顺序删除点，它的上行邻居两两相连。只需把其余上行邻居并入
+    // 层级最低的那个（消去树上的父亲），其他的边在处理父亲时自然补上
+    std::vector<std::vector<int>> upNeighbors(numNodes);
+    for (const Edge& edge : edges) {
+        if (edge.from == edge.to || edge.from < 0 || edge.to < 0 || edge.from >= n || edge.to >= n) {
+            continue;
+        }
+        int a = ranks[edge.from];
+        int b = ranks[edge.to];
+        upNeighbors[std::min(a, b)].push_back(std::max(a, b));
+    }
+    parents.assign(numNodes, -1);
+    upOffsets.assign(numNodes + 1, 0);
+    for (int node = 0; node < n; node++) {
+        std::vector<int>& up = upNeighbors[node];
+        std::sort(up.begin(), up.end());
+        up.erase(std::unique(up.begin(), up.end()), up.end());
+        if (!up.empty()) {
+            parents[node] = up.front();
+            std::vector<int>& parentUp = upNeighbors[up.front()];
+            parentUp.insert(parentUp.end(), up.begin() + 1, up.end());
+        }
+        upOffsets[node + 1] = upOffsets[node] + static_cast<int>(up.size());
+    }
+    upTargets.resize(upOffsets.back());
+    for (int node = 0; node < n; node++) {
+        std::copy(upNeighbors[node].begin(), upNeighbors[node].end(), upTargets.begin() + upOffsets[node]);
+        std::vector<int>().swap(upNeighbors[node]);
+    }
+    upWeights.assign(upTargets.size(), std::numeric_limits<double>::infinity());
+    upMiddles.assign(upTargets.size(), -1);
+    
+    // 下行邻接：按源点层级升序
+    downOffsets.assign(numNodes + 1, 0);
+    for (int target : upTargets) {
+        downOffsets[target + 1]++;
+    }
+    for (int node = 0; node < n; node++) {
+        downOffsets[node + 1] += downOffsets[node];
+    }
+    downSources.resize(upTargets.size());
+    downArcs.resize(upTargets.size());
+    std::vector<int> cursor(downOffsets.begin(), downOffsets.end() - 1);
+    for (int node = 0; node < n; node++) {
+        for (int k = upOffsets[node]; k < upOffsets[node + 1]; k++) {
+            int slot = cursor[upTargets[k]]++;
+            downSources[slot] = node;
+            downArcs[slot] = k;
+        }
+    }
+    
+    // 层级深度：没有下方邻居的点为0层，其余比最深的下方邻居深一层
+    std::vector<int> depths(numNodes, 0);
+    int maxDepth = 0;
+    for (int node = 0; node < n; node++) {
+        for (int k = downOffsets[node]; k < downOffsets[node + 1]; k++) {
+            depths[node] = std::max(depths[node], depths[downSources[k]] + 1);
+        }
+        maxDepth = std::max(maxDepth, depths[node]);
+    }
+    levelOffsets.assign(maxDepth + 2, 0);
+    for (int node = 0; node < n; node++) {
+        levelOffsets[depths[node] + 1]++;
+    }
+    for (int level = 0; level <= maxDepth; level++) {
+        levelOffsets[level + 1] += levelOffsets[level];
+    }
+    levelNodes.resize(numNodes);
+    std::vector<int> levelCursor(levelOffsets.begin(), levelOffsets.end() - 1);
+    for (int node = 0; node < n; node++) {
+        levelNodes[levelCursor[depths[node]]++] = node;
+    }
+    
+    inputArcs.assign(edges.size(), -1);
+    for (size_t i = 0; i < edges.size(); i++) {
+        const Edge& edge = edges[i];
+        if (edge.from == edge.to || edge.from < 0 || edge.to < 0 || edge.from >= n || edge.to >= n) {
+            continue;
+        }
+        int a = ranks[edge.from];
+        int b = ranks[edge.to];
+        inputArcs[i] = findArc(std::min(a, b), std::max(a, b));
+    }
+}
+
+int CustomizableHierarchy::findArc(int lower, int higher) const {
+    auto first = upTargets.begin() + upOffsets[lower];
+    auto last = upTargets.begin() + upOffsets[lower + 1];
+    auto it = std::lower_bound(first, last, higher);
+    return (it != last && *it == higher) ? static_cast<int>(it - upTargets.begin()) : -1;
+}
+
+void CustomizableHierarchy::relaxLowerTriangles(int node, int downBegin, int downEnd, double* weights, int* middles,
+                                                std::vector<int>& arcOfTarget) const {
+    const int first = upOffsets[node];
+    for (int k = first; k < upOffsets[node + 1]; k++) {
+        arcOfTarget[upTargets[k]] = k - first;
+    }
+    
+    // 下三角 (lower, node, w)：lower 的上行边按目标层级升序，node 之后的都是 node 的上行邻居
+    for (int d = downBegin; d < downEnd; d++) {
+        int lower = downSources[d];
+        int toNode = downArcs[d];
+        double toNodeWeight = upWeights[toNode];
+        if (toNodeWeight == std::numeric_limits<double>::infinity()) {
+            continue;
+        }
+        for (int k = toNode + 1; k < upOffsets[lower + 1]; k++) {
+            int slot = arcOfTarget[upTargets[k]];
+            double weight = toNodeWeight + upWeights[k];
+            if (weight < weights[slot]) {
+                weights[slot] = weight;
+                middles[slot] = lower;
+            }
+        }
+    }
+    
+    for (int k = first; k < upOffsets[node + 1]; k++) {
+        arcOfTarget[upTargets[k]] = -1;
+    }
+}
+
+void CustomizableHierarchy::customize(const double* weights, bool parallel) {
+    if (empty()) {
+        return;
+    }
+    const size_t numNodes = ranks.size();
+    
+    std::fill(upWeights.begin(), upWeights.end(), std::numeric_limits<double>::infinity());
+    std::fill(upMiddles.begin(), upMiddles.end(), -1);
+    for (size_t i = 0; i < inputArcs.size(); i++) {
+        int arc = inputArcs[i];
+        if (arc >= 0 && weights[i] < upWeights[arc]) {
+            upWeights[arc] = weights[i];
+        }
+    }
+    
+    // 上行邻居 -> 本点上行边的相对下标，每个线程一份，用后复位为-1
+    auto threadArcOfTarget = [numNodes]() -> std::vector<int>& {
+        thread_local std::vector<int> arcOfTarget;
+        if (arcOfTarget.size() < numNodes) {
+            arcOfTarget.assign(numNodes, -1);
+        }
+        return arcOfTarget;
+    };
+    
+    // 逐层处理：同一层的点只读下方各层已定好的边，只写自己的上行边
+    TaskPool& pool = TaskPool::shared();
+    bool useThreads = parallel && pool.getThreadCount() > 1;
+    for (size_t level = 0; level + 1 < levelOffsets.size(); level++) {
+        size_t begin = levelOffsets[level];
+        size_t end = levelOffsets[level + 1];
+        if (useThreads && end - begin > static_cast<size_t>(CUSTOMIZATION_GRAIN)) {
+            pool.parallelFor(begin, end, CUSTOMIZATION_GRAIN, [this, &threadArcOfTarget](size_t blockBegin, size_t blockEnd) {
+                std::vector<int>& arcOfTarget = threadArcOfTarget();
+                for (size_t i = blockBegin; i < blockEnd; i++) {
+                    int node = levelNodes[i];
+                    relaxLowerTriangles(node, downOffsets[node], downOffsets[node + 1], &upWeights[0] + upOffsets[node],
+                                        &upMiddles[0] + upOffsets[node], arcOfTarget);
+                }
+            });
+            continue;
+        }
+    
+        // 靠近顶层的各层只有少数几个点，但它们的上行边和下三角最多：把每个点的下方邻居分块并行，
+        // 各块在私有数组中求最小值，再加锁合并
+        for (size_t i = begin; i < end; i++) {
+            int node = levelNodes[i];
+            int downBegin = downOffsets[node];
+            int downEnd = downOffsets[node + 1];
+            double* nodeWeights = &upWeights[0] + upOffsets[node];
+            int* nodeMiddles = &upMiddles[0] + upOffsets[node];
+            if (!useThreads || downEnd - downBegin <= TRIANGLE_GRAIN) {
+                relaxLowerTriangles(node, downBegin, downEnd, nodeWeights, nodeMiddles, threadArcOfTarget());
+                continue;
+            }
+            const int degree = upOffsets[node + 1] - upOffsets[node];
+            std::mutex mergeMutex;
+            pool.parallelFor(downBegin, downEnd, TRIANGLE_GRAIN, [&](size_t blockBegin, size_t blockEnd) {
+                std::vector<double> blockWeights(degree, std::numeric_limits<double>::infinity());
+                std::vector<int> blockMiddles(degree, -1);
+                relaxLowerTriangles(node, static_cast<int>(blockBegin), static_cast<int>(blockEnd),
+                                    blockWeights.data(), blockMiddles.data(), threadArcOfTarget());
+                std::lock_guard<std::mutex> lock(mergeMutex);
+                for (int k = 0; k < degree; k++) {
+                    if (blockWeights[k] < nodeWeights[k]) {
+                        nodeWeights[k] = blockWeights[k];
+                        nodeMiddles[k] = blockMiddles[k];
+                    }
+                }
+            });
+        }
+    }
+    customized = true;
+}
+
+void CustomizableHierarchy::unpackArc(int from, int to, std::vector<int>& path) const {
+    // 用显式栈展开；下三角顶点的层级低于两端，展开必然结束
+    std::vector<std::pair<int, int>> stack;
+    stack.emplace_back(from, to);
+    while (!stack.empty()) {
+        std::pair<int, int> segment = stack.back();
+        stack.pop_back();
+        int arc = findArc(std::min(segment.first, segment.second), std::max(segment.first, segment.second));
+        int middle = (arc >= 0) ? upMiddles[arc] : -1;
+        if (middle < 0) {
+            path.push_back(order[segment.second]);
+        } else {
+            // 先展开前半段：后压入的先处理
+            stack.emplace_back(middle, segment.second);
+            stack.emplace_back(segment.first, middle);
+        }
+    }
+}
+
+double CustomizableHierarchy::query(int source, int target, std::vector<int>* path, size_t* scannedNodes) const {
+    const double infinity = std::numeric_limits<double>::infinity();
+    if (path) {
+        path->clear();
+    }
+    if (scannedNodes) {
+        *scannedNodes = 0;
+    }
+    const int n = static_cast<int>(ranks.size());
+    if (!customized || source < 0 || target < 0 || source >= n || target >= n) {
+        return infinity;
+    }
+    
+    int sourceRank = ranks[source];
+    int targetRank = ranks[target];
+    SearchWorkspace& forward = SearchWorkspace::forCurrentThread(0);
+    SearchWorkspace& backward = SearchWorkspace::forCurrentThread(1);
+    forward.begin(ranks.size());
+    backward.begin(ranks.size());
+    forward.update(sourceRank, 0.0, -1);
+    backward.update(targetRank, 0.0, -1);
+    
+    // 上行邻居都是消去树上的祖先，所以两侧只会到达各自链上的点。两条链按层级从低到高交替推进，
+    // 扫描到一个点时它的代价已经确定；两侧在公共祖先上汇合时更新最佳代价，
+    // 代价不小于最佳代价的点不再向上松弛
+    double bestCost = infinity;
+    int meeting = -1;
+    size_t scannedCount = 0;
+    auto scan = [&](SearchWorkspace& side, int node) {
+        double nodeCost = side.cost(node);
+        if (nodeCost >= bestCost) {
+            return;
+        }
+        scannedCount++;
+        for (int k = upOffsets[node]; k < upOffsets[node + 1]; k++) {
+            side.update(upTargets[k], nodeCost + upWeights[k], node);
+        }
+    };
+    int forwardNode = sourceRank;
+    int backwardNode = targetRank;
+    while (forwardNode != -1 || backwardNode != -1) {
+        if (backwardNode == -1 || (forwardNode != -1 && forwardNode < backwardNode)) {
+            scan(forward, forwardNode);
+            forwardNode = parents[forwardNode];
+        } else if (forwardNode == -1 || backwardNode < forwardNode) {
+            scan(backward, backwardNode);
+            backwardNode = parents[backwardNode];
+        } else {
+            int node = forwardNode;
+            if (forward.cost(node) + backward.cost(node) < bestCost) {
+                bestCost = forward.cost(node) + backward.cost(node);
+                meeting = node;
+            }
+            scan(forward, node);
+            scan(backward, node);
+            forwardNode = parents[node];
+            backwardNode = parents[node];
+        }
+    }
+    
+    if (scannedNodes) {
+        *scannedNodes = scannedCount;
+    }
+    if (meeting < 0) {
+        return infinity;
+    }
+    
+    if (path) {
+        // 上行图中的路径：起点到相遇点，再从相遇点沿反向前驱到终点
+        std::vector<int> upPath;
+        for (int at = meeting; at != -1; at = forward.previous(at)) {
+            upPath.push_back(at);
+        }
+        std::reverse(upPath.begin(), upPath.end());
+        for (int at = backward.previous(meeting); at != -1; at = backward.previous(at)) {
+            upPath.push_back(at);
+        }
+    
+        // 逐条展开捷径，并换回稠密索引
+        path->push_back(order[upPath.front()]);
+        for (size_t i = 1; i < upPath.size(); i++) {
+            unpackArc(upPath[i - 1], upPath[i], *path);
+        }
+    }
+    return bestCost;
+}
+
+size_t CustomizableHierarchy::memoryUsage() const {
+    size_t ints = order.capacity() + ranks.capacity() + parents.capacity() + upOffsets.capacity() +
+                  upTargets.capacity() + upMiddles.capacity() + downOffsets.capacity() + downSources.capacity() +
+                  downArcs.capacity() + levelOffsets.capacity() + levelNodes.capacity() + inputArcs.capacity();
+    return ints * sizeof(int) + upWeights.capacity() * sizeof(double);
+}
@@ -0,0 +1,99 @@
+#ifndef CUSTOMIZABLE_HIERARCHY_H
+#define CUSTOMIZABLE_HIERARCHY_H
+
+#include <vector>
+#include <cstddef>
+
+// 可定制收缩层次(Customizable Contraction Hierarchies)：用于边权随时间变化的最快路径查询
+//
+// 预处理只依赖路网拓扑和点的位置：按坐标递归二分做嵌套剖分，分隔点排在两侧子图之后，
+// 再按这个顺序做不带见证搜索的符号收缩，得到与边权无关的上行图（每个点的上行邻居两两相连）。
+// 定制阶段只改边权：先填入原始道路的权值，再自底向上对每条上行边取所有下三角
+// (u, v)、(u, w) 之和的最小值。同一层级（其下方邻居都已处理）的点互不依赖，在线程池上并行，
+// 每一层只写本点的上行边，不需要加锁。路况变化后重新定制即可，不需要重新预处理。
+//
+// 查询沿消去树（每个点的父亲是它层级最低的上行邻居）从起点和终点各自向上扫描，不需要优先队列；
+// 两条链的公共祖先中代价之和最小的点即为最高点，代价已超过它的点不再扩展。捷径按其下三角中的点展开
+class CustomizableHierarchy {
+public:
+    // 预处理的输入边（无向），下标与定制时的权值数组一致；端点无效的边被忽略
+    struct Edge {
+        int from;
+        int to;
+    };
+    
+    // 嵌套剖分中点数不超过该值的子图不再划分
+    static constexpr int DISSECTION_LEAF_SIZE = 16;
+    
+    // 并行定制时每个任务至少处理的点数
+    static constexpr int CUSTOMIZATION_GRAIN = 256;
+    
+    // 点数较少的层中，单个点的下三角按下方邻居分块并行，每块至少包含的下方邻居数
+    static constexpr int TRIANGLE_GRAIN = 32;
+
+private:
+    // 以下数组都按层级（收缩顺序）编号，不是输入的稠密索引
+    std::vector<int> order;     // 层级 -> 稠密索引
+    std::vector<int> ranks;     // 稠密索引 -> 层级
+    std::vector<int> parents;   // 消去树上的父亲，根为-1
+    
+    // 上行图（CSR）：点r的上行边位于 [upOffsets[r], upOffsets[r + 1])，目标按层级升序排列
+    std::vector<int> upOffsets;
+    std::vector<int> upTargets;
+    std::vector<double> upWeights;  // 当前定制的权值，不连通时为无穷大
+    std::vector<int> upMiddles;     // 取得最小值的下三角顶点，原始道路为-1
+    
+    // 下行邻接（CSR）：点r的下方邻居及对应上行边的下标，定制时枚举下三角用
+    std::vector<int> downOffsets;
+    std::vector<int> downSources;
+    std::vector<int> downArcs;
+    
+    // 按层级深度分组的点：第i层的点位于 levelNodes[levelOffsets[i], levelOffsets[i + 1])
+    std::vector<int> levelOffsets;
+    std::vector<int> levelNodes;
+    
+    // 每条输入边对应的上行边下标，无效边为-1
+    std::vector<int> inputArcs;
+    
+    bool customized;
+    
+    // 按点的坐标做嵌套剖分，写入 order 和 ranks
+    void computeOrder(size_t numNodes, const std::vector<Edge>& edges, const double* xs, const double* ys);
+    
+    // 层级 lower < higher 的两点之间的上行边下标，不存在时返回-1
+    int findArc(int lower, int higher) const;
+    
+    // 用 node 的下方邻居 downSources[downBegin, downEnd) 构成的下三角更新它的上行边，结果与 weights/middles
+    // （按 node 的上行边顺序排列）取最小值；这些下方邻居的上行边须已定制完成
+    void relaxLowerTriangles(int node, int downBegin, int downEnd, double* weights, int* middles,
+                             std::vector<int>& arcOfTarget) const;
+    
+    // 把层级编号下的边 (from, to) 展开成原图中的点序列，追加到 path 末尾（不含 from，已换回稠密索引）
+    void unpackArc(int from, int to, std::vector<int>& path) const;
+
+public:
+    CustomizableHierarchy();
+    
+    // 对 numNodes 个点（坐标为 xs、ys）和给定的无向边做与边权无关的预处理，之后需要定制才能查询
+    void build(size_t numNodes, const std::vector<Edge>& edges, const double* xs, const double* ys);
+    
+    // 用新的边权定制：weights[i] 为第i条输入边的权值（重复的边取较小者）；
+    // parallel 为 true 时按层在共享线程池上并行
+    void customize(const double* weights, bool parallel = true);
+    
+    void clear();
+    bool empty() const { return ranks.empty(); }
+    bool isCustomized() const { return customized; }
+    size_t getNodeCount() const { return ranks.size(); }
+    size_t getArcCount() const { return upTargets.size(); }
+    size_t getLevelCount() const { return levelOffsets.empty() ? 0 : levelOffsets.size() - 1; }
+    
+    // 按当前定制的权值计算 source 到 target 的最小代价，不可达时为无穷大。
+    // path 不为空时写入途经点的稠密索引（含起终点，不可达时为空）；scannedNodes 不为空时写入向上松弛过的点数
+    double query(int source, int target, std::vector<int>* path = nullptr, size_t* scannedNodes = nullptr) const;
+    
+    // 占用的字节数（不含 vector 对象本身）
+    size_t memoryUsage() const;
+};
+
+#endif // CUSTOMIZABLE_HIERARCHY_H
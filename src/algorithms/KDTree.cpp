@@ -1,231 +1,724 @@
 #include "KDTree.h"
+#include "../core/GeometryKernels.h"
+#include "../core/SpaceFillingCurve.h"
 #include <queue>
-#include <numeric>
 #include <algorithm> // 添加这个头文件以使用std::nth_element
 
-KDTree::KDTree() : root(nullptr), dimensions(2) {}
-
-KDTree::~KDTree() {
-    deleteTree(root);
+KDTree::KDTree() : bucketSize(DEFAULT_BUCKET_SIZE), liveSize(0) {
 }
 
-void KDTree::deleteTree(KDNode* node) {
-    if (node) {
-        deleteTree(node->left);
-        deleteTree(node->right);
-        delete node;
-    }
+namespace {
+
+int clampBucketSize(int bucketSize) {
+    return std::max(1, std::min(bucketSize, KDTree::MAX_BUCKET_SIZE));
 }
 
-double KDTree::calculateVariance(const std::vector<Point*>& points, int start, int end, int axis) {
-    if (start > end) return 0.0;
-    
-    double sum = 0.0;
-    double sumSq = 0.0;
+} // namespace
+
+int KDTree::selectBestSplitAxis(const std::vector<BuildEntry>& entries, int start, int end) const {
     int count = end - start + 1;
     
-    for (int i = start; i <= end; i++) {
-        double value = (axis == 0) ? points[i]->getX() : points[i]->getY();
-        sum += value;
-        sumSq += value * value;
+    // 大区间按固定步长取样估计方差，每层的代价与区间大小无关
+    int step = std::max(1, count / VARIANCE_SAMPLE_SIZE);
+    double sumX = 0.0, sumXSq = 0.0;
+    double sumY = 0.0, sumYSq = 0.0;
+    int samples = 0;
+    for (int i = start; i <= end; i += step) {
+        sumX += entries[i].x;
+        sumXSq += entries[i].x * entries[i].x;
+        sumY += entries[i].y;
+        sumYSq += entries[i].y * entries[i].y;
+        samples++;
     }
     
-    double mean = sum / count;
-    return (sumSq / count) - (mean * mean);
-}
-
-int KDTree::selectBestSplitAxis(const std::vector<Point*>& points, int start, int end) {
-    double xVariance = calculateVariance(points, start, end, 0);
-    double yVariance = calculateVariance(points, start, end, 1);
+    double meanX = sumX / samples;
+    double meanY = sumY / samples;
+    double xVariance = (sumXSq / samples) - (meanX * meanX);
+    double yVariance = (sumYSq / samples) - (meanY * meanY);
     
     return (xVariance >= yVariance) ? 0 : 1;
 }
 
-// 使用std::nth_element替代quickSelect
-int KDTree::quickSelect(std::vector<Point*>& points, int start, int end, int k, int axis) {
-    // 使用lambda表达式定义比较函数，根据指定轴进行比较
-    auto compareByAxis = [axis](const Point* a, const Point* b) {
-        double aValue = (axis == 0) ? a->getX() : a->getY();
-        double bValue = (axis == 0) ? b->getX() : b->getY();
-        return aValue < bValue;
-    };
-    
-    // 使用std::nth_element找到第k个元素
-    std::nth_element(points.begin() + start, points.begin() + k, points.begin() + end + 1, compareByAxis);
-    
-    return k;
+void KDTree::StaticTree::clear() {
+    xs.clear();
+    ys.clear();
+    points.clear();
+    axes.clear();
+    removed.clear();
+    removedCount = 0;
+    computeBounds();
+}
+
+void KDTree::StaticTree::computeBounds() {
+    boundsMin[0] = boundsMin[1] = std::numeric_limits<double>::infinity();
+    boundsMax[0] = boundsMax[1] = -std::numeric_limits<double>::infinity();
+    for (size_t i = 0; i < xs.size(); i++) {
+        boundsMin[0] = std::min(boundsMin[0], xs[i]);
+        boundsMax[0] = std::max(boundsMax[0], xs[i]);
+        boundsMin[1] = std::min(boundsMin[1], ys[i]);
+        boundsMax[1] = std::max(boundsMax[1], ys[i]);
+    }
+}
+
+void KDTree::build(const std::vector<Point*>& points, int bucketSize, bool parallel) {
+    this->bucketSize = clampBucketSize(bucketSize);
+    trees.assign(1, StaticTree());
+    buildStaticTree(trees[0], points, parallel);
+    liveSize = points.size();
 }
 
-void KDTree::build(const std::vector<Point*>& points) {
+void KDTree::buildStaticTree(StaticTree& tree, const std::vector<Point*>& points, bool parallel) {
+    tree.clear();
     if (points.empty()) {
         return;
     }
     
-    // 复制点集合，因为我们需要对其进行排序
-    std::vector<Point*> pointsCopy = points;
+    const int numPoints = static_cast<int>(points.size());
+    TaskPool& pool = TaskPool::shared();
+    parallel = parallel && numPoints >= PARALLEL_BUILD_CUTOFF * 2 && pool.getThreadCount() > 1;
+    
+    // 把坐标复制到连续的临时数组中划分，避免划分时反复解引用 Point*
+    std::vector<BuildEntry> entries(numPoints);
+    auto fillEntries = [&](size_t begin, size_t end) {
+        for (size_t i = begin; i < end; i++) {
+            entries[i].x = points[i]->getX();
+            entries[i].y = points[i]->getY();
+            entries[i].point = points[i];
+        }
+    };
     
-    // 重新排列点以提高缓存效率
-    reorderPointsForCacheEfficiency(pointsCopy);
+    tree.axes.assign(numPoints, 0);
+    if (parallel) {
+        pool.parallelFor(0, numPoints, PARALLEL_BUILD_CUTOFF, fillEntries);
+        
+        // 顶层的区间同时处理的子树少于线程数，用并行划分补足并行度
+        std::vector<BuildEntry> scratch(numPoints);
+        int parallelSelectMin = std::max(PARALLEL_SELECT_CUTOFF, numPoints / pool.getThreadCount());
+        buildTreeParallel(tree, entries, scratch, 0, numPoints - 1, parallelSelectMin, pool);
+    } else {
+        fillEntries(0, numPoints);
+        buildTree(tree, entries, 0, numPoints - 1);
+    }
     
-    // 使用串行版本构建树
-    root = buildTree(pointsCopy, 0, 0, pointsCopy.size() - 1);
+    // 划分完成后条目的顺序就是节点布局
+    tree.xs.resize(numPoints);
+    tree.ys.resize(numPoints);
+    tree.points.resize(numPoints);
+    auto copyNodes = [&](size_t begin, size_t end) {
+        for (size_t i = begin; i < end; i++) {
+            tree.xs[i] = entries[i].x;
+            tree.ys[i] = entries[i].y;
+            tree.points[i] = entries[i].point;
+        }
+    };
+    if (parallel) {
+        pool.parallelFor(0, numPoints, PARALLEL_BUILD_CUTOFF, copyNodes);
+    } else {
+        copyNodes(0, numPoints);
+    }
+    tree.computeBounds();
 }
 
-KDNode* KDTree::buildTree(std::vector<Point*>& points, int depth, int start, int end) {
-    if (start > end) {
-        return nullptr;
+void KDTree::buildTree(StaticTree& tree, std::vector<BuildEntry>& entries, int start, int end) {
+    // 叶子桶内的点不需要排序
+    if (start > end || isLeaf(start, end)) {
+        return;
     }
     
     // 选择最佳分割维度
-    int axis = selectBestSplitAxis(points, start, end);
+    int axis = selectBestSplitAxis(entries, start, end);
     
-    // 选择中位数作为分割点
+    // 选择中位数作为分割点，左侧的点在该轴上不大于它，右侧不小于它
     int mid = start + (end - start) / 2;
-    
-    // 使用快速选择算法找到中位数
-    int pivotIndex = quickSelect(points, start, end, mid, axis);
-    
-    // 创建节点，并保存分割维度
-    KDNode* node = new KDNode(points[pivotIndex], axis);
+    std::nth_element(entries.begin() + start, entries.begin() + mid, entries.begin() + end + 1,
+                     [axis](const BuildEntry& a, const BuildEntry& b) {
+                         return (axis == 0) ? a.x < b.x : a.y < b.y;
+                     });
+    tree.axes[mid] = static_cast<uint8_t>(axis);
     
     // 递归构建左右子树
-    node->left = buildTree(points, depth + 1, start, pivotIndex - 1);
-    node->right = buildTree(points, depth + 1, pivotIndex + 1, end);
-    
-    return node;
+    buildTree(tree, entries, start, mid - 1);
+    buildTree(tree, entries, mid + 1, end);
 }
 
-Point* KDTree::findNearest(double x, double y) {
-    if (!root) {
-        return nullptr;
+void KDTree::buildTreeParallel(StaticTree& tree, std::vector<BuildEntry>& entries, std::vector<BuildEntry>& scratch,
+                               int start, int end, int parallelSelectMin, TaskPool& pool) {
+    int count = end - start + 1;
+    if (count < PARALLEL_BUILD_CUTOFF) {
+        buildTree(tree, entries, start, end);
+        return;
     }
     
-    Point target(-1, x, y);
-    Point* nearest = nullptr;
-    double bestDist = std::numeric_limits<double>::max();
-    
-    nearestNeighborSearch(root, target, 0, nearest, bestDist);
+    int axis = selectBestSplitAxis(entries, start, end);
+    int mid = start + (end - start) / 2;
+    if (count >= parallelSelectMin) {
+        parallelSelect(entries, scratch, start, end, mid, axis, pool);
+    } else {
+        std::nth_element(entries.begin() + start, entries.begin() + mid, entries.begin() + end + 1,
+                         [axis](const BuildEntry& a, const BuildEntry& b) {
+                             return (axis == 0) ? a.x < b.x : a.y < b.y;
+                         });
+    }
+    tree.axes[mid] = static_cast<uint8_t>(axis);
+    
+    // 左右子树互不重叠，左子树交给线程池，右子树在当前线程构建
+    TaskPool::TaskGroup group(pool);
+    group.run([this, &tree, &entries, &scratch, &pool, start, mid, parallelSelectMin] {
+        buildTreeParallel(tree, entries, scratch, start, mid - 1, parallelSelectMin, pool);
+    });
+    buildTreeParallel(tree, entries, scratch, mid + 1, end, parallelSelectMin, pool);
+    group.wait();
+}
+
+void KDTree::parallelSelect(std::vector<BuildEntry>& entries, std::vector<BuildEntry>& scratch,
+                            int start, int end, int k, int axis, TaskPool& pool) const {
+    auto key = [axis](const BuildEntry& e) { return (axis == 0) ? e.x : e.y; };
+    
+    const int numBlocks = pool.getThreadCount();
+    std::vector<int> lessCounts(numBlocks);
+    std::vector<int> equalCounts(numBlocks);
+    std::vector<int> greaterCounts(numBlocks);
+    
+    int lo = start;
+    int hi = end + 1;
+    while (hi - lo > PARALLEL_SELECT_CUTOFF) {
+        int n = hi - lo;
+        
+        // 等距取样，以样本中与k相对位置相同的值为枢轴，使k所在的一侧尽量小
+        const int SAMPLE_COUNT = 255;
+        double samples[SAMPLE_COUNT];
+        for (int i = 0; i < SAMPLE_COUNT; i++) {
+            samples[i] = key(entries[lo + static_cast<int>(static_cast<long long>(n) * i / SAMPLE_COUNT)]);
+        }
+        int rank = static_cast<int>(static_cast<long long>(k - lo) * SAMPLE_COUNT / n);
+        std::nth_element(samples, samples + rank, samples + SAMPLE_COUNT);
+        double pivot = samples[rank];
+        
+        int blockSize = (n + numBlocks - 1) / numBlocks;
+        auto blockRange = [&](int block, int& begin, int& finish) {
+            begin = std::min(hi, lo + block * blockSize);
+            finish = std::min(hi, begin + blockSize);
+        };
+        
+        // 第一遍：各块统计小于/等于/大于枢轴的数量
+        pool.parallelFor(0, numBlocks, 1, [&](size_t firstBlock, size_t lastBlock) {
+            for (size_t block = firstBlock; block < lastBlock; block++) {
+                int begin, finish;
+                blockRange(static_cast<int>(block), begin, finish);
+                int less = 0, equal = 0;
+                for (int i = begin; i < finish; i++) {
+                    double value = key(entries[i]);
+                    less += (value < pivot);
+                    equal += (value == pivot);
+                }
+                lessCounts[block] = less;
+                equalCounts[block] = equal;
+                greaterCounts[block] = (finish - begin) - less - equal;
+            }
+        });
+        
+        int totalLess = 0, totalEqual = 0;
+        for (int block = 0; block < numBlocks; block++) {
+            totalLess += lessCounts[block];
+            totalEqual += equalCounts[block];
+        }
+        
+        // 前缀和得到每块在三个区域中的写入位置（原地改写计数数组）
+        int lessCursor = lo, equalCursor = lo + totalLess, greaterCursor = lo + totalLess + totalEqual;
+        for (int block = 0; block < numBlocks; block++) {
+            int less = lessCounts[block], equal = equalCounts[block], greater = greaterCounts[block];
+            lessCounts[block] = lessCursor;
+            equalCounts[block] = equalCursor;
+            greaterCounts[block] = greaterCursor;
+            lessCursor += less;
+            equalCursor += equal;
+            greaterCursor += greater;
+        }
+        
+        // 第二遍：各块把元素写入 scratch 中对应的区域，再拷回
+        pool.parallelFor(0, numBlocks, 1, [&](size_t firstBlock, size_t lastBlock) {
+            for (size_t block = firstBlock; block < lastBlock; block++) {
+                int begin, finish;
+                blockRange(static_cast<int>(block), begin, finish);
+                int lessOut = lessCounts[block], equalOut = equalCounts[block], greaterOut = greaterCounts[block];
+                for (int i = begin; i < finish; i++) {
+                    double value = key(entries[i]);
+                    if (value < pivot) {
+                        scratch[lessOut++] = entries[i];
+                    } else if (value == pivot) {
+                        scratch[equalOut++] = entries[i];
+                    } else {
+                        scratch[greaterOut++] = entries[i];
+                    }
+                }
+            }
+        });
+        pool.parallelFor(lo, hi, PARALLEL_BUILD_CUTOFF, [&](size_t begin, size_t finish) {
+            std::copy(scratch.begin() + begin, scratch.begin() + finish, entries.begin() + begin);
+        });
+        
+        if (k < lo + totalLess) {
+            hi = lo + totalLess;
+        } else if (k < lo + totalLess + totalEqual) {
+            return; // 第k个元素等于枢轴，已经就位
+        } else {
+            lo = lo + totalLess + totalEqual;
+        }
+    }
     
-    return nearest;
+    std::nth_element(entries.begin() + lo, entries.begin() + k, entries.begin() + hi,
+                     [axis](const BuildEntry& a, const BuildEntry& b) {
+                         return (axis == 0) ? a.x < b.x : a.y < b.y;
+                     });
 }
 
-void KDTree::nearestNeighborSearch(KDNode* node, const Point& target, int depth, 
-                                  Point*& nearest, double& bestDist) {
-    if (!node) {
+size_t KDTree::memoryUsage() const {
+    size_t bytes = 0;
+    for (const StaticTree& tree : trees) {
+        bytes += tree.xs.capacity() * sizeof(double) + tree.ys.capacity() * sizeof(double) +
+                 tree.points.capacity() * sizeof(Point*) + tree.axes.capacity() * sizeof(uint8_t) +
+                 tree.removed.capacity() * sizeof(uint8_t);
+    }
+    return bytes;
+}
+
+void KDTree::exportLayout(std::vector<Point*>& order, std::vector<int>& axes) const {
+    if (!isCompact()) {
+        // 森林没有对应的单一布局，按当前的点重新构建一棵树再导出
+        std::vector<Point*> live;
+        live.reserve(liveSize);
+        for (const StaticTree& tree : trees) {
+            collectLivePoints(tree, live);
+        }
+        KDTree compacted;
+        compacted.build(live, bucketSize);
+        compacted.exportLayout(order, axes);
         return;
     }
-    
-    // 使用节点中记录的分割维度，而不是depth % dimensions
-    int axis = node->splitAxis;
-    
-    // 计算当前点到目标的距离
-    double dist = target.distanceTo(*(node->point));
-    
-    // 如果当前点更近，更新最近点
-    if (dist < bestDist) {
-        bestDist = dist;
-        nearest = node->point;
+    if (trees.empty()) {
+        order.clear();
+        axes.clear();
+        return;
     }
-    
-    // 确定搜索方向
-    double axisValue = (axis == 0) ? target.getX() : target.getY();
-    double nodeValue = (axis == 0) ? node->point->getX() : node->point->getY();
-    
-    KDNode* nearBranch = (axisValue < nodeValue) ? node->left : node->right;
-    KDNode* farBranch = (axisValue < nodeValue) ? node->right : node->left;
-    
-    // 先搜索更可能包含最近点的分支
-    nearestNeighborSearch(nearBranch, target, depth + 1, nearest, bestDist);
-    
-    // 计算目标点到分割超平面的距离
-    double planeDistance = std::abs(axisValue - nodeValue);
-    
-    // 检查是否需要搜索另一个分支
-    if (planeDistance * planeDistance < bestDist) {
-        nearestNeighborSearch(farBranch, target, depth + 1, nearest, bestDist);
+    order.assign(trees[0].points.begin(), trees[0].points.end());
+    axes.assign(trees[0].axes.begin(), trees[0].axes.end());
+}
+
+void KDTree::buildFromLayout(const std::vector<Point*>& order, const std::vector<int>& axes, int bucketSize) {
+    this->bucketSize = clampBucketSize(bucketSize);
+    trees.assign(1, StaticTree());
+    liveSize = 0;
+    StaticTree& tree = trees[0];
+    tree.clear();
+    if (order.empty() || order.size() != axes.size()) {
+        return;
     }
+    tree.points = order;
+    tree.axes.assign(axes.begin(), axes.end());
+    tree.xs.resize(order.size());
+    tree.ys.resize(order.size());
+    for (size_t i = 0; i < order.size(); i++) {
+        tree.xs[i] = order[i]->getX();
+        tree.ys[i] = order[i]->getY();
+    }
+    tree.computeBounds();
+    liveSize = order.size();
 }
 
-std::vector<Point*> KDTree::findKNearest(double x, double y, int k) {
-    if (!root || k <= 0) {
-        return std::vector<Point*>();
+void KDTree::collectLivePoints(const StaticTree& tree, std::vector<Point*>& out) {
+    for (size_t i = 0; i < tree.size(); i++) {
+        if (!tree.isRemoved(static_cast<int>(i))) {
+            out.push_back(tree.points[i]);
+        }
+    }
+}
+
+void KDTree::insert(Point* point) {
+    if (trees.empty()) {
+        trees.resize(1);
+        trees[0].clear();
     }
     
-    Point target(-1, x, y);
-    
-    // 修改：使用默认的最大优先队列 (std::less by default)
-    std::priority_queue<std::pair<double, Point*>> nearestPoints; 
+    // 从第1层起找到第一个空层，把前面各层的点连同新点一起重建到该层
+    std::vector<Point*> merged(1, point);
+    size_t level = 1;
+    while (level < trees.size() && trees[level].size() > 0) {
+        collectLivePoints(trees[level], merged);
+        trees[level].clear();
+        level++;
+    }
+    if (level == trees.size()) {
+        trees.emplace_back();
+    }
+    buildStaticTree(trees[level], merged, true);
+    liveSize++;
     
-    kNearestNeighborSearch(root, target, 0, nearestPoints, k);
+    // 插入层的点数超过主树时整体并入主树：主树规模至少翻倍后才会再次合并，层数保持在 O(log n)
+    size_t mainCount = trees[0].liveCount();
+    if (liveSize - mainCount > mainCount) {
+        compact();
+    }
+}
+
+bool KDTree::remove(Point* point) {
+    for (StaticTree& tree : trees) {
+        int node = locate(tree, point);
+        if (node < 0) {
+            continue;
+        }
+        if (tree.removed.empty()) {
+            tree.removed.assign(tree.size(), 0);
+        }
+        tree.removed[node] = 1;
+        tree.removedCount++;
+        liveSize--;
+        
+        // 标记过多时只重建这一棵树，代价由之前的删除分摊
+        if (tree.removedCount * 2 > tree.size()) {
+            std::vector<Point*> live;
+            live.reserve(tree.liveCount());
+            collectLivePoints(tree, live);
+            buildStaticTree(tree, live, true);
+        }
+        return true;
+    }
+    return false;
+}
+
+void KDTree::compact() {
+    std::vector<Point*> live;
+    live.reserve(liveSize);
+    for (const StaticTree& tree : trees) {
+        collectLivePoints(tree, live);
+    }
+    trees.assign(1, StaticTree());
+    buildStaticTree(trees[0], live, true);
+    liveSize = live.size();
+}
+
+bool KDTree::isCompact() const {
+    for (size_t i = 1; i < trees.size(); i++) {
+        if (trees[i].size() > 0) {
+            return false;
+        }
+    }
+    return trees.empty() || trees[0].removedCount == 0;
+}
+
+int KDTree::locate(const StaticTree& tree, const Point* point) const {
+    if (tree.liveCount() == 0) {
+        return -1;
+    }
+    const double x = point->getX();
+    const double y = point->getY();
+    
+    StackEntry stack[MAX_STACK_DEPTH];
+    int top = 0;
+    stack[top++] = {0, static_cast<int>(tree.size()) - 1, 0.0};
+    
+    while (top > 0) {
+        StackEntry entry = stack[--top];
+        int start = entry.start;
+        int end = entry.end;
+        while (start <= end) {
+            if (isLeaf(start, end)) {
+                for (int i = start; i <= end; i++) {
+                    if (tree.points[i] == point && !tree.isRemoved(i)) {
+                        return i;
+                    }
+                }
+                break;
+            }
+            
+            int mid = start + (end - start) / 2;
+            if (tree.points[mid] == point && !tree.isRemoved(mid)) {
+                return mid;
+            }
+            
+            // 与分割坐标相等的点可能被划分到任意一侧
+            double key = (tree.axes[mid] == 0) ? x : y;
+            double split = (tree.axes[mid] == 0) ? tree.xs[mid] : tree.ys[mid];
+            if (key < split) {
+                end = mid - 1;
+            } else if (key > split) {
+                start = mid + 1;
+            } else {
+                if (mid + 1 <= end) {
+                    stack[top++] = {mid + 1, end, 0.0};
+                }
+                end = mid - 1;
+            }
+        }
+    }
+    return -1;
+}
+
+namespace {
+
+// 有界的近邻结果集，保存到目前为止距离最近的k个候选
+// 小k时维护升序数组，插入时把更远的候选后移一位，数据都在调用者的栈上；
+// 大k时维护最大堆，避免每次插入O(k)的移动
+template<typename Neighbor>
+class BoundedNeighborSet {
+private:
+    Neighbor* items;
+    int capacity;
+    int count;
+    bool useHeap;
+    
+    static bool closer(const Neighbor& a, const Neighbor& b) {
+        return a.distSq < b.distSq;
+    }
+
+public:
+    BoundedNeighborSet(Neighbor* storage, int k, bool useHeap)
+        : items(storage), capacity(k), count(0), useHeap(useHeap) {}
+    
+    bool full() const { return count == capacity; }
+    
+    // 当前第K近的距离平方，只在 full() 时有意义
+    double worst() const { return useHeap ? items[0].distSq : items[count - 1].distSq; }
+    
+    void offer(double distSq, Point* point) {
+        if (count == capacity) {
+            if (distSq >= worst()) {
+                return;
+            }
+            if (useHeap) {
+                std::pop_heap(items, items + count, closer);
+                count--;
+            } else {
+                count--; // 丢弃最远的一个
+            }
+        }
+        if (useHeap) {
+            items[count].distSq = distSq;
+            items[count].point = point;
+            count++;
+            std::push_heap(items, items + count, closer);
+        } else {
+            int i = count++;
+            while (i > 0 && items[i - 1].distSq > distSq) {
+                items[i] = items[i - 1];
+                i--;
+            }
+            items[i].distSq = distSq;
+            items[i].point = point;
+        }
+    }
     
-    // 提取点
-    std::vector<Point*> result;
-    result.reserve(nearestPoints.size()); // 预分配空间，大小为实际找到的点数
+    // 结束搜索，保证结果按距离升序排列，返回数量
+    int finish() {
+        if (useHeap) {
+            std::sort_heap(items, items + count, closer);
+        }
+        return count;
+    }
+};
+
+// 扫描叶子桶：桶较大时先用向量化内核算出整桶的距离平方，再逐个提交给结果集；
+// removed 为删除标记数组，没有删除时为空指针
+template<typename NeighborSet>
+void scanBucket(const double* xs, const double* ys, Point* const* points, const uint8_t* removed,
+                int start, int end, double x, double y, NeighborSet& nearest) {
+    int count = end - start + 1;
+    if (count < 4) {
+        for (int i = start; i <= end; i++) {
+            if (removed && removed[i]) {
+                continue;
+            }
+            double dx = xs[i] - x;
+            double dy = ys[i] - y;
+            nearest.offer(dx * dx + dy * dy, points[i]);
+        }
+        return;
+    }
+    double distSq[KDTree::MAX_BUCKET_SIZE];
+    GeometryKernels::squaredDistances(xs + start, ys + start, count, x, y, distSq);
+    for (int i = 0; i < count; i++) {
+        if (removed && removed[start + i]) {
+            continue;
+        }
+        nearest.offer(distSq[i], points[start + i]);
+    }
+}
+
+} // namespace
+
+Point* KDTree::findNearest(double x, double y) const {
+    if (empty()) {
+        return nullptr;
+    }
     
-    while (!nearestPoints.empty()) {
-        result.push_back(nearestPoints.top().second);
-        nearestPoints.pop();
+    Neighbor nearest;
+    if (kNearestNeighborSearch(x, y, 1, SearchOptions(), &nearest) == 0) {
+        return nullptr;
+    }
+    return nearest.point;
+}
+
+std::vector<Point*> KDTree::findKNearest(double x, double y, int k) const {
+    if (empty() || k <= 0) {
+        return std::vector<Point*>();
     }
-    // 结果中的点顺序是按距离从大到小排列的。如果需要从小到大，可以反转。
-    std::reverse(result.begin(), result.end()); 
     
+    std::vector<Point*> result(std::min(static_cast<size_t>(k), liveSize));
+    result.resize(findKNearest(x, y, k, result.data()));
     return result;
 }
 
-void KDTree::kNearestNeighborSearch(KDNode* node, const Point& target, int depth, 
-                                   std::priority_queue<std::pair<double, Point*>>& nearestPoints, // 修改：匹配最大优先队列
-                                   int k) {
-    if (!node) {
+void KDTree::findKNearestBatch(const double* queryXs, const double* queryYs, size_t numQueries, int k,
+                               std::vector<size_t>& offsets, std::vector<Point*>& results,
+                               bool parallel) const {
+    // 每个查询返回的数量相同，偏移量可以直接算出，各查询并行写入互不重叠的区间
+    size_t perQuery = (empty() || k <= 0) ? 0 : std::min(static_cast<size_t>(k), liveSize);
+    offsets.resize(numQueries + 1);
+    for (size_t i = 0; i <= numQueries; i++) {
+        offsets[i] = i * perQuery;
+    }
+    results.resize(numQueries * perQuery);
+    if (perQuery == 0) {
         return;
     }
     
-    // 修改：使用节点存储的分割轴
-    int axis = node->splitAxis; 
+    std::vector<uint32_t> order;
+    SpaceFillingCurve::mortonOrder(queryXs, queryYs, numQueries, order);
     
-    // 计算当前点到目标的距离
-    double dist = target.distanceTo(*(node->point));
+    auto runQueries = [&](size_t begin, size_t end) {
+        for (size_t i = begin; i < end; i++) {
+            uint32_t query = order[i];
+            findKNearest(queryXs[query], queryYs[query], k, results.data() + offsets[query]);
+        }
+    };
     
-    // 修改：更新最大优先队列的逻辑
-    if (nearestPoints.size() < k) {
-        nearestPoints.push(std::make_pair(dist, node->point));
-    } else if (dist < nearestPoints.top().first) { // 如果当前点比队列中距离最大的点还要近
-        nearestPoints.pop(); // 移除当前K个点中距离最大的
-        nearestPoints.push(std::make_pair(dist, node->point)); // 插入当前点
+    TaskPool& pool = TaskPool::shared();
+    if (parallel && pool.getThreadCount() > 1) {
+        pool.parallelFor(0, numQueries, BATCH_QUERY_GRAIN, runQueries);
+    } else {
+        runQueries(0, numQueries);
+    }
+}
+
+int KDTree::findKNearest(double x, double y, int k, Point** results) const {
+    return findKNearest(x, y, k, SearchOptions(), results, nullptr);
+}
+
+int KDTree::findKNearest(double x, double y, int k, const SearchOptions& options,
+                         Point** results, double* distances) const {
+    if (empty() || k <= 0) {
+        return 0;
+    }
+    k = static_cast<int>(std::min(static_cast<size_t>(k), liveSize));
+    
+    Neighbor* neighbors;
+    Neighbor local[SMALL_K_LIMIT];
+    if (k <= SMALL_K_LIMIT) {
+        neighbors = local;
+    } else {
+        // 大k的候选缓冲区按线程复用，只在第一次遇到更大的k时扩容
+        thread_local std::vector<Neighbor> buffer;
+        if (buffer.size() < static_cast<size_t>(k)) {
+            buffer.resize(k);
+        }
+        neighbors = buffer.data();
     }
     
-    // 确定搜索方向
-    double axisValue = (axis == 0) ? target.getX() : target.getY();
-    double nodeValue = (axis == 0) ? node->point->getX() : node->point->getY();
-    
-    KDNode* nearBranch = (axisValue < nodeValue) ? node->left : node->right;
-    KDNode* farBranch = (axisValue < nodeValue) ? node->right : node->left;
-    
-    // 先搜索更可能包含最近点的分支
-    kNearestNeighborSearch(nearBranch, target, depth + 1, nearestPoints, k);
-    
-    // 修改：剪枝逻辑，配合最大优先队列
-    // current_kth_distance 是当前找到的K个点中，距离目标点最远的那个点的距离
-    double current_kth_distance = std::numeric_limits<double>::max();
-    if (nearestPoints.size() == k) {
-        current_kth_distance = nearestPoints.top().first;
+    int count = kNearestNeighborSearch(x, y, k, options, neighbors);
+    for (int i = 0; i < count; i++) {
+        results[i] = neighbors[i].point;
+    }
+    if (distances) {
+        for (int i = 0; i < count; i++) {
+            distances[i] = std::sqrt(neighbors[i].distSq);
+        }
+    }
+    return count;
+}
+
+template<typename NeighborSet>
+void KDTree::searchTree(const StaticTree& tree, double x, double y, double pruneScale,
+                        long long& visitBudget, NeighborSet& nearest) const {
+    const uint8_t* removed = (tree.removedCount > 0) ? tree.removed.data() : nullptr;
+    
+    // 根节点的距离下界取查询点到整棵树包围盒的距离，离得远的插入层整棵跳过
+    double dx0 = std::max({tree.boundsMin[0] - x, 0.0, x - tree.boundsMax[0]});
+    double dy0 = std::max({tree.boundsMin[1] - y, 0.0, y - tree.boundsMax[1]});
+    
+    // 用显式栈代替递归：沿查询点所在一侧下降到底，另一侧的子树连同距离下界入栈
+    StackEntry stack[MAX_STACK_DEPTH];
+    int top = 0;
+    stack[top++] = {0, static_cast<int>(tree.size()) - 1, dx0 * dx0 + dy0 * dy0};
+    
+    while (top > 0 && visitBudget > 0) {
+        StackEntry entry = stack[--top];
+        
+        // 子树所在区域比当前第K近的点还远（近似查询时放宽到 1 + epsilon 倍），整棵子树都可以跳过
+        if (nearest.full() && entry.minDistSq * pruneScale >= nearest.worst()) {
+            continue;
+        }
+        
+        int start = entry.start;
+        int end = entry.end;
+        while (start <= end) {
+            if (isLeaf(start, end)) {
+                scanBucket(tree.xs.data(), tree.ys.data(), tree.points.data(), removed, start, end, x, y, nearest);
+                visitBudget -= end - start + 1;
+                break;
+            }
+            
+            int mid = start + (end - start) / 2;
+            visitBudget--;
+            
+            // 计算当前点到目标的距离平方
+            double dx = tree.xs[mid] - x;
+            double dy = tree.ys[mid] - y;
+            if (!removed || !removed[mid]) {
+                nearest.offer(dx * dx + dy * dy, tree.points[mid]);
+            }
+            
+            // 目标点到分割超平面的有向距离，负数表示在左侧
+            double planeDistance = (tree.axes[mid] == 0) ? -dx : -dy;
+            double farDistSq = std::max(entry.minDistSq, planeDistance * planeDistance);
+            
+            if (planeDistance < 0) {
+                if (mid + 1 <= end) {
+                    stack[top++] = {mid + 1, end, farDistSq};
+                }
+                end = mid - 1;
+            } else {
+                if (start <= mid - 1) {
+                    stack[top++] = {start, mid - 1, farDistSq};
+                }
+                start = mid + 1;
+            }
+        }
     }
+}
+
+int KDTree::kNearestNeighborSearch(double x, double y, int k, const SearchOptions& options, Neighbor* results) const {
+    BoundedNeighborSet<Neighbor> nearest(results, k, k > SMALL_K_LIMIT);
     
-    // 计算目标点到分割超平面的距离
-    double planeDistance = std::abs(axisValue - nodeValue);
+    double scale = 1.0 + std::max(options.epsilon, 0.0);
+    long long visitBudget = (options.maxVisitedNodes > 0) ? options.maxVisitedNodes
+                                                           : std::numeric_limits<long long>::max();
     
-    // 检查是否需要搜索另一个分支
-    // 只有当 “目标点到分割超平面的距离” 小于 “当前已找到的第K近的点的距离”
-    // 或者 当我们还没找够K个点时，才需要搜索另一分支
-    if (planeDistance < current_kth_distance || nearestPoints.size() < k) {
-        kNearestNeighborSearch(farBranch, target, depth + 1, nearestPoints, k);
+    // 主树最大，先搜索它得到较紧的第K近距离，之后的插入层大多在根部就被剪掉
+    for (const StaticTree& tree : trees) {
+        if (visitBudget <= 0) {
+            break;
+        }
+        if (tree.liveCount() > 0) {
+            searchTree(tree, x, y, scale * scale, visitBudget, nearest);
+        }
     }
+    return nearest.finish();
 }
 
-bool KDTree::sphereBoundsOverlap(const Point& center, double radius, double minBounds[2], double maxBounds[2]) {
+bool KDTree::sphereBoundsOverlap(double x, double y, double radiusSq, const double minBounds[2], const double maxBounds[2]) const {
     double distSq = 0;
     
-    for (int i = 0; i < dimensions; i++) {
-        double coord = (i == 0) ? center.getX() : center.getY();
+    for (int i = 0; i < 2; i++) {
+        double coord = (i == 0) ? x : y;
         double minCoord = minBounds[i];
         double maxCoord = maxBounds[i];
         
@@ -236,31 +729,23 @@ bool KDTree::sphereBoundsOverlap(const Point& center, double radius, double minB
         }
     }
     
-    return distSq <= radius * radius;
+    return distSq <= radiusSq;
 }
 
-void KDTree::reorderPointsForCacheEfficiency(std::vector<Point*>& points) {
-    if (points.size() <= 1) return;
-    
-    std::vector<Point*> reordered;
-    reordered.reserve(points.size());
-    
-    // 使用层序遍历重新排列点
-    std::queue<std::pair<int, int>> queue;
-    queue.push({0, static_cast<int>(points.size() - 1)});
-    
-    while (!queue.empty()) {
-        auto [start, end] = queue.front();
-        queue.pop();
-        
-        if (start <= end) {
-            int mid = start + (end - start) / 2;
-            reordered.push_back(points[mid]);
-            
-            queue.push({start, mid - 1});
-            queue.push({mid + 1, end});
-        }
-    }
-    
-    points = reordered;
-}
\ No newline at end of file
+bool KDTree::sphereContainsBounds(double x, double y, double radiusSq, const double minBounds[2], const double maxBounds[2]) const {
+    double dx = std::max(x - minBounds[0], maxBounds[0] - x);
+    double dy = std::max(y - minBounds[1], maxBounds[1] - y);
+    return dx * dx + dy * dy <= radiusSq;
+}
+
+std::vector<Point*> KDTree::findWithinRadius(double x, double y, double radius) const {
+    std::vector<Point*> result;
+    visitWithinRadius(x, y, radius, [&result](Point* point) { result.push_back(point); });
+    return result;
+}
+
+std::vector<Point*> KDTree::findInRect(double minX, double minY, double maxX, double maxY) const {
+    std::vector<Point*> result;
+    visitInRect(minX, minY, maxX, maxY, [&result](Point* point) { result.push_back(point); });
+    return result;
+}
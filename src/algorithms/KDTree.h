@@ -5,78 +5,371 @@
 #include <algorithm>
 #include <cmath>
 #include <limits>
-#include <queue>
-#include <memory>
-// 移除 #include <omp.h>
+#include <cstdint>
 #include "../core/Point.h"
+#include "../core/GeometryKernels.h"
+#include "../core/TaskPool.h"
 
-// KD树节点
-struct KDNode {
-    Point* point;
-    KDNode* left;
-    KDNode* right;
-    int splitAxis;  // 添加分割维度字段
-    
-    KDNode(Point* p, int axis = 0) : point(p), left(nullptr), right(nullptr), splitAxis(axis) {}
-};
-
-// 用于K最近邻搜索的比较器
-struct DistanceComparator {
-    bool operator()(const std::pair<double, Point*>& a, const std::pair<double, Point*>& b) const {
-        return a.first < b.first; // 小顶堆，距离小的优先
-    }
-};
-
+// 扁平的隐式KD树
+//
+// 所有节点存放在几个按节点下标对齐的连续数组中，没有逐节点的堆分配和左右指针：
+// 下标区间 [start, end] 对应一棵子树，根节点位于 mid = start + (end - start) / 2，
+// 左子树为 [start, mid - 1]，右子树为 [mid + 1, end]（即中序布局）。
+// 节点坐标直接内联在 xs/ys 中，查询过程中不需要解引用 Point*，
+// 只有返回结果时才用到 points。
+//
+// 桶模式：点数不超过 bucketSize 的子树不再继续划分，作为叶子桶整体存放，
+// 查询到叶子时对连续的坐标数组做一次向量化的线性扫描。bucketSize 为1时即每个点一个节点
+//
+// 动态更新：静态树本身不可修改，insert/remove 通过若干棵大小按2的幂增长的静态树
+// （对数森林）实现，查询依次搜索每棵树；批量 build 之后只有一棵树，查询代价与之前相同
 class KDTree {
+public:
+    // 默认的叶子桶大小和允许的最大值
+    static constexpr int DEFAULT_BUCKET_SIZE = 32;
+    static constexpr int MAX_BUCKET_SIZE = 256;
+    
+    // 并行构建的阈值：小于该规模的子树串行构建
+    static constexpr int PARALLEL_BUILD_CUTOFF = 16384;
+    
+    // 并行划分的最小区间，更小的区间直接用 std::nth_element
+    static constexpr int PARALLEL_SELECT_CUTOFF = 65536;
+    
+    // 估计方差时最多使用的样本数
+    static constexpr int VARIANCE_SAMPLE_SIZE = 1024;
+    
+    // 批量查询时每个并行任务至少处理的查询数
+    static constexpr int BATCH_QUERY_GRAIN = 256;
+    
+    // 近似K近邻查询的选项，默认值即精确查询
+    struct SearchOptions {
+        // 允许的相对误差：区域的距离下界乘以 (1 + epsilon) 仍不小于当前第K近距离时剪掉，
+        // 返回的第i个结果到查询点的距离不超过真实第i近距离的 (1 + epsilon) 倍
+        double epsilon = 0.0;
+        
+        // 最多访问的节点数（叶子桶中的每个点算一个节点），0 表示不限制。
+        // 只在回溯到新的子树前检查，第一次下降到叶子的路径总会走完，所以结果不会为空
+        int maxVisitedNodes = 0;
+    };
+
 private:
-    KDNode* root;
-    int dimensions;
+    // 一棵静态的隐式KD树，布局见上。删除的点只打标记，查询时跳过
+    struct StaticTree {
+        std::vector<double> xs;           // 节点坐标x
+        std::vector<double> ys;           // 节点坐标y
+        std::vector<Point*> points;       // 节点对应的点
+        std::vector<uint8_t> axes;        // 节点的分割轴（0为x，1为y），叶子桶中的点不使用
+        std::vector<uint8_t> removed;     // 删除标记，没有删除过点时为空
+        size_t removedCount = 0;
+        double boundsMin[2];              // 所有点的包围盒，作为根节点的区域
+        double boundsMax[2];
+        
+        size_t size() const { return points.size(); }
+        size_t liveCount() const { return points.size() - removedCount; }
+        bool isRemoved(int node) const { return removedCount > 0 && removed[node]; }
+        void clear();
+        void computeBounds();
+    };
     
-    // 递归构建KD树
-    KDNode* buildTree(std::vector<Point*>& points, int depth, int start, int end);
+    // 对数森林：trees[0] 是 build 构建的主树；trees[i]（i >= 1）是插入产生的第i层，
+    // 为空或最多容纳 2^(i-1) 个点。插入像二进制计数器进位一样，把前面的非空层连同新点
+    // 合并重建到第一个空层，每个点最多被重建 O(log n) 次；插入层的点数超过主树时整体并入主树
+    std::vector<StaticTree> trees;
+    int bucketSize;                       // 叶子桶的最大点数
+    size_t liveSize;                      // 未删除的点数
     
-    // 移除并行构建KD树方法，改为串行版本
-    // KDNode* buildTreeParallel(std::vector<Point*>& points, int depth, int start, int end, int minSizeForParallel = 1000);
+    // 构建时使用的临时条目，按轴划分后写入上面的数组
+    struct BuildEntry {
+        double x;
+        double y;
+        Point* point;
+    };
     
-    // 递归查找最近的点
-    void nearestNeighborSearch(KDNode* node, const Point& target, int depth, 
-                              Point*& nearest, double& bestDist);
+    // 区间 [start, end] 是否为叶子桶
+    bool isLeaf(int start, int end) const { return end - start < bucketSize; }
     
-    // 递归查找K个最近的点（优化版）
-    void kNearestNeighborSearch(KDNode* node, const Point& target, int depth, 
-                               std::priority_queue<std::pair<double, Point*>>& nearestPoints, // 修改：改为默认的最大优先队列
-                               int k);
+    // 用给定的点构建一棵静态树，parallel 为 true 且点数足够多时使用共享线程池
+    void buildStaticTree(StaticTree& tree, const std::vector<Point*>& points, bool parallel);
     
-    // 递归删除KD树
-    void deleteTree(KDNode* node);
+    // 递归构建区间 [start, end] 的子树
+    void buildTree(StaticTree& tree, std::vector<BuildEntry>& entries, int start, int end);
     
-    // 计算指定维度上的方差
-    double calculateVariance(const std::vector<Point*>& points, int start, int end, int axis);
+    // 并行构建：规模超过 PARALLEL_BUILD_CUTOFF 的子树把左半边交给线程池，
+    // 规模不小于 parallelSelectMin 的区间（树的顶层）用并行划分寻找中位数
+    void buildTreeParallel(StaticTree& tree, std::vector<BuildEntry>& entries, std::vector<BuildEntry>& scratch,
+                           int start, int end, int parallelSelectMin, TaskPool& pool);
     
-    // 选择最佳分割维度
-    int selectBestSplitAxis(const std::vector<Point*>& points, int start, int end);
+    // 并行版本的 nth_element：按样本选枢轴，各线程分块统计后三路划分到 scratch 再拷回，
+    // 只在包含第k个元素的一侧继续，区间足够小时交给 std::nth_element
+    void parallelSelect(std::vector<BuildEntry>& entries, std::vector<BuildEntry>& scratch,
+                        int start, int end, int k, int axis, TaskPool& pool) const;
     
-    // 使用std::nth_element找中位数（保留函数名以兼容现有代码）
-    int quickSelect(std::vector<Point*>& points, int start, int end, int k, int axis);
+    // 选择最佳分割维度：比较两个轴上的方差，大区间只在等距样本上估计
+    int selectBestSplitAxis(const std::vector<BuildEntry>& entries, int start, int end) const;
+    
+    // 遍历栈的容量：隐式树的高度不超过 log2(节点数) + 1，64 足以覆盖任何 int 规模
+    static constexpr int MAX_STACK_DEPTH = 64;
+    
+    // k 不超过该值时，结果集放在栈上的有序数组中；更大的 k 使用线程局部的最大堆
+    static constexpr int SMALL_K_LIMIT = 128;
+    
+    // 待访问的子树区间，minDistSq 是查询点到该子树所在区域距离平方的下界
+    struct StackEntry {
+        int start;
+        int end;
+        double minDistSq;
+    };
+    
+    // 一个候选近邻：到查询点的距离平方和对应的点
+    struct Neighbor {
+        double distSq;
+        Point* point;
+    };
+    
+    // 迭代式K近邻搜索，依次搜索森林中的每棵树，结果按距离平方升序写入 results（容量至少为k），
+    // 返回找到的数量
+    int kNearestNeighborSearch(double x, double y, int k, const SearchOptions& options, Neighbor* results) const;
+    
+    // 在一棵静态树中搜索，把候选提交给结果集（结果集在各棵树之间共享，已有的第K近距离用于剪枝）。
+    // 距离下界乘以 pruneScale 后比较；visitBudget 为剩余可访问的节点数，耗尽后不再回溯
+    template<typename NeighborSet>
+    void searchTree(const StaticTree& tree, double x, double y, double pruneScale,
+                    long long& visitBudget, NeighborSet& nearest) const;
     
     // 检查球面边界是否重叠
-    bool sphereBoundsOverlap(const Point& center, double radius, double minBounds[2], double maxBounds[2]);
+    bool sphereBoundsOverlap(double x, double y, double radiusSq, const double minBounds[2], const double maxBounds[2]) const;
     
+    // 包围盒是否完全落在圆内（最远的角也在圆内）
+    bool sphereContainsBounds(double x, double y, double radiusSq, const double minBounds[2], const double maxBounds[2]) const;
+    
+    // 范围查询中待访问的子树区间及其所在区域（由祖先的分割面围成）
+    struct RegionEntry {
+        int start;
+        int end;
+        double minBounds[2];
+        double maxBounds[2];
+    };
+    
+    // 单棵静态树上的范围查询，跳过已删除的点
+    template<typename Visitor>
+    void visitTreeWithinRadius(const StaticTree& tree, double x, double y, double radiusSq, Visitor& visit) const;
+    template<typename Visitor>
+    void visitTreeInRect(const StaticTree& tree, double minX, double minY, double maxX, double maxY, Visitor& visit) const;
+    
+    // 在静态树中查找点所在的节点下标：沿分割轴下降，坐标相等时两侧都要找；找不到返回-1
+    int locate(const StaticTree& tree, const Point* point) const;
+    
+    // 把树中未删除的点追加到 out
+    static void collectLivePoints(const StaticTree& tree, std::vector<Point*>& out);
+
 public:
     KDTree();
-    ~KDTree();
     
-    // 构建KD树
-    void build(const std::vector<Point*>& points);
+    // 构建KD树，bucketSize 会被限制在 [1, MAX_BUCKET_SIZE] 内；
+    // parallel 为 true 且点数足够多时使用共享线程池并行构建
+    void build(const std::vector<Point*>& points, int bucketSize = DEFAULT_BUCKET_SIZE, bool parallel = true);
     
     // 查找最近的点
-    Point* findNearest(double x, double y);
+    Point* findNearest(double x, double y) const;
     
-    // 查找K个最近的点
-    std::vector<Point*> findKNearest(double x, double y, int k);
+    // 查找K个最近的点，按距离从近到远排列
+    std::vector<Point*> findKNearest(double x, double y, int k) const;
     
-    // 重新排列点以提高缓存效率
-    void reorderPointsForCacheEfficiency(std::vector<Point*>& points);
+    // 同上，但把结果写入调用者提供的数组（容量至少为k），返回写入的数量；
+    // 查询过程不分配内存（k 大于 SMALL_K_LIMIT 时复用线程局部缓冲区）
+    int findKNearest(double x, double y, int k, Point** results) const;
+    
+    // 近似K近邻查询：按 options 放宽剪枝条件或限制访问的节点数，提前结束搜索。
+    // distances 不为空时写入每个结果到查询点的距离（容量至少为k），调用者可据此判断精度
+    int findKNearest(double x, double y, int k, const SearchOptions& options,
+                     Point** results, double* distances) const;
+    
+    // 批量K近邻查询：对 numQueries 个查询点 (queryXs[i], queryYs[i]) 各找K个最近的点，
+    // 结果按CSR形式输出，第i个查询的结果为 results[offsets[i], offsets[i + 1])，按距离从近到远排列。
+    // 查询先按 Morton 序重排，使相邻执行的查询访问树的同一部分；
+    // parallel 为 true 时把排好序的查询分块交给共享线程池
+    void findKNearestBatch(const double* queryXs, const double* queryYs, size_t numQueries, int k,
+                           std::vector<size_t>& offsets, std::vector<Point*>& results,
+                           bool parallel = true) const;
+    
+    // 树是否为空 / 点数（不含已删除的点）
+    bool empty() const { return liveSize == 0; }
+    size_t size() const { return liveSize; }
+    int getBucketSize() const { return bucketSize; }
+    
+    // 插入一个点，均摊 O(log^2 n)；点的坐标在插入后不能改变
+    void insert(Point* point);
+    
+    // 删除一个点，点不在树中时返回 false。删除只打标记，
+    // 一棵静态树中超过一半的点被删除时重建该树，回收空间并恢复查询效率
+    bool remove(Point* point);
+    
+    // 把森林合并成一棵不含删除标记的静态树
+    void compact();
+    
+    // 是否只有一棵不含删除标记的树（此时 exportLayout 无需重建）
+    bool isCompact() const;
+    
+    // 范围查询：返回到 (x, y) 距离不超过 radius 的点 / 落在矩形内（含边界）的点，顺序不定
+    std::vector<Point*> findWithinRadius(double x, double y, double radius) const;
+    std::vector<Point*> findInRect(double minX, double minY, double maxX, double maxY) const;
+    
+    // 访问者形式的范围查询：对每个命中的点调用 visit(Point*)，查询过程不分配内存。
+    // 用子树区域剪枝：区域与查询范围不相交时跳过整棵子树，完全包含时直接访问整个下标区间
+    template<typename Visitor>
+    void visitWithinRadius(double x, double y, double radius, Visitor&& visit) const;
+    template<typename Visitor>
+    void visitInRect(double minX, double minY, double maxX, double maxY, Visitor&& visit) const;
+    
+    // 树占用的字节数（不含 vector 对象本身）
+    size_t memoryUsage() const;
+    
+    // 导出/导入树的隐式布局：order[i] 与 axes[i] 是第i个节点的点和分割轴，
+    // 与内部数组的布局完全一致，导出和导入都是线性拷贝；导入时需给出构建时的桶大小。
+    // 用于把构建好的树保存到地图文件中，加载时无需重新做中位数划分。
+    // 森林不紧凑时导出的是把所有点重新构建成一棵树后的布局
+    void exportLayout(std::vector<Point*>& order, std::vector<int>& axes) const;
+    void buildFromLayout(const std::vector<Point*>& order, const std::vector<int>& axes, int bucketSize = 1);
 };
 
-#endif // KDTREE_H
\ No newline at end of file
+template<typename Visitor>
+void KDTree::visitWithinRadius(double x, double y, double radius, Visitor&& visit) const {
+    if (empty() || !(radius >= 0)) {
+        return;
+    }
+    const double radiusSq = radius * radius;
+    for (const StaticTree& tree : trees) {
+        if (tree.liveCount() > 0) {
+            visitTreeWithinRadius(tree, x, y, radiusSq, visit);
+        }
+    }
+}
+
+template<typename Visitor>
+void KDTree::visitInRect(double minX, double minY, double maxX, double maxY, Visitor&& visit) const {
+    if (empty() || !(minX <= maxX) || !(minY <= maxY)) {
+        return;
+    }
+    for (const StaticTree& tree : trees) {
+        if (tree.liveCount() > 0) {
+            visitTreeInRect(tree, minX, minY, maxX, maxY, visit);
+        }
+    }
+}
+
+template<typename Visitor>
+void KDTree::visitTreeWithinRadius(const StaticTree& tree, double x, double y, double radiusSq, Visitor& visit) const {
+    RegionEntry stack[MAX_STACK_DEPTH];
+    int top = 0;
+    stack[top++] = {0, static_cast<int>(tree.size()) - 1,
+                    {tree.boundsMin[0], tree.boundsMin[1]}, {tree.boundsMax[0], tree.boundsMax[1]}};
+    
+    while (top > 0) {
+        RegionEntry entry = stack[--top];
+        if (entry.start > entry.end ||
+            !sphereBoundsOverlap(x, y, radiusSq, entry.minBounds, entry.maxBounds)) {
+            continue;
+        }
+        
+        // 整个区域都在圆内，子树对应的连续区间全部命中
+        if (sphereContainsBounds(x, y, radiusSq, entry.minBounds, entry.maxBounds)) {
+            for (int i = entry.start; i <= entry.end; i++) {
+                if (!tree.isRemoved(i)) {
+                    visit(tree.points[i]);
+                }
+            }
+            continue;
+        }
+        
+        if (isLeaf(entry.start, entry.end)) {
+            int count = entry.end - entry.start + 1;
+            double distSq[MAX_BUCKET_SIZE];
+            GeometryKernels::squaredDistances(tree.xs.data() + entry.start, tree.ys.data() + entry.start,
+                                              count, x, y, distSq);
+            for (int i = 0; i < count; i++) {
+                if (distSq[i] <= radiusSq && !tree.isRemoved(entry.start + i)) {
+                    visit(tree.points[entry.start + i]);
+                }
+            }
+            continue;
+        }
+        
+        int mid = entry.start + (entry.end - entry.start) / 2;
+        double dx = tree.xs[mid] - x;
+        double dy = tree.ys[mid] - y;
+        if (dx * dx + dy * dy <= radiusSq && !tree.isRemoved(mid)) {
+            visit(tree.points[mid]);
+        }
+        
+        // 按分割面切开区域，左子树在分割轴上不大于节点坐标，右子树不小于
+        int axis = tree.axes[mid];
+        double split = (axis == 0) ? tree.xs[mid] : tree.ys[mid];
+        RegionEntry left = entry;
+        left.end = mid - 1;
+        left.maxBounds[axis] = split;
+        RegionEntry right = entry;
+        right.start = mid + 1;
+        right.minBounds[axis] = split;
+        stack[top++] = right;
+        stack[top++] = left;
+    }
+}
+
+template<typename Visitor>
+void KDTree::visitTreeInRect(const StaticTree& tree, double minX, double minY, double maxX, double maxY, Visitor& visit) const {
+    RegionEntry stack[MAX_STACK_DEPTH];
+    int top = 0;
+    stack[top++] = {0, static_cast<int>(tree.size()) - 1,
+                    {tree.boundsMin[0], tree.boundsMin[1]}, {tree.boundsMax[0], tree.boundsMax[1]}};
+    
+    while (top > 0) {
+        RegionEntry entry = stack[--top];
+        if (entry.start > entry.end ||
+            entry.maxBounds[0] < minX || entry.minBounds[0] > maxX ||
+            entry.maxBounds[1] < minY || entry.minBounds[1] > maxY) {
+            continue;
+        }
+        
+        // 整个区域都在矩形内，子树对应的连续区间全部命中
+        if (entry.minBounds[0] >= minX && entry.maxBounds[0] <= maxX &&
+            entry.minBounds[1] >= minY && entry.maxBounds[1] <= maxY) {
+            for (int i = entry.start; i <= entry.end; i++) {
+                if (!tree.isRemoved(i)) {
+                    visit(tree.points[i]);
+                }
+            }
+            continue;
+        }
+        
+        if (isLeaf(entry.start, entry.end)) {
+            int hits[MAX_BUCKET_SIZE];
+            size_t count = GeometryKernels::filterInBox(tree.xs.data() + entry.start, tree.ys.data() + entry.start,
+                                                        entry.end - entry.start + 1, minX, minY, maxX, maxY, hits);
+            for (size_t i = 0; i < count; i++) {
+                if (!tree.isRemoved(entry.start + hits[i])) {
+                    visit(tree.points[entry.start + hits[i]]);
+                }
+            }
+            continue;
+        }
+        
+        int mid = entry.start + (entry.end - entry.start) / 2;
+        if (tree.xs[mid] >= minX && tree.xs[mid] <= maxX && tree.ys[mid] >= minY && tree.ys[mid] <= maxY &&
+            !tree.isRemoved(mid)) {
+            visit(tree.points[mid]);
+        }
+        
+        int axis = tree.axes[mid];
+        double split = (axis == 0) ? tree.xs[mid] : tree.ys[mid];
+        RegionEntry left = entry;
+        left.end = mid - 1;
+        left.maxBounds[axis] = split;
+        RegionEntry right = entry;
+        right.start = mid + 1;
+        right.minBounds[axis] = split;
+        stack[top++] = right;
+        stack[top++] = left;
+    }
+}
+
+#endif // KDTREE_H
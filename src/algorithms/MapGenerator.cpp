@@ -1,6 +1,7 @@
 #include "MapGenerator.h"
 #include "../core/Point.h"
 #include "../core/Road.h"
+#include "../core/GeometryKernels.h"
 #include <random>
 
 #include <algorithm>
@@ -11,28 +12,64 @@ MapGenerator::MapGenerator(int numPoints, double width, double height, double ma
     : numPoints(numPoints), mapWidth(width), mapHeight(height), maxRoadDistance(maxRoadDistance) {
 }
 
+const int MAX_CONNECTIONS_PER_POINT = 3; // 定义每个点最多连接到最近的N个点
+
+uint64_t MapGenerator::getParameterKey() const {
+    // FNV-1a，逐字节混入每个参数
+    uint64_t hash = 14695981039346656037ull;
+    auto mix = [&hash](const void* data, size_t bytes) {
+        const unsigned char* p = static_cast<const unsigned char*>(data);
+        for (size_t i = 0; i < bytes; i++) {
+            hash ^= p[i];
+            hash *= 1099511628211ull;
+        }
+    };
+    
+    uint32_t version = GENERATOR_VERSION;
+    int32_t connections = MAX_CONNECTIONS_PER_POINT;
+    int32_t pointCount = numPoints;
+    mix(&version, sizeof(version));
+    mix(&connections, sizeof(connections));
+    mix(&pointCount, sizeof(pointCount));
+    mix(&mapWidth, sizeof(mapWidth));
+    mix(&mapHeight, sizeof(mapHeight));
+    mix(&maxRoadDistance, sizeof(maxRoadDistance));
+    return hash;
+}
+
 Map* MapGenerator::generateMap(std::function<void(float)> progressCallback) const {
     Map* map = new Map();
     
-    // 生成随机点
-    std::vector<Point*> points = generateRandomPoints();
+    // 预先分配点和道路的存储，使竞技场中的对象保持连续
+    map->reserveCapacity(numPoints, static_cast<size_t>(numPoints) * MAX_CONNECTIONS_PER_POINT);
     
-    // 将点添加到地图
-    for (auto point : points) {
-        map->addPoint(point);
-    }
+    // 生成随机点并加入地图
+    std::vector<Point*> points = generateRandomPoints(map);
     
     // 创建道路
     createRoads(map, points);
     
+    // 冻结拓扑，连通性检查在CSR上进行
+    map->freezeTopology();
+    
     // 确保地图连通性
     ensureConnectivity(map);
     
-    return map;
+    // 连通性修补可能新增道路，重新构建CSR
+    if (!map->isTopologyFrozen()) {
+        map->freezeTopology();
+    }
+    
+    // 随机生成的点在内存中的顺序与位置无关，按 Hilbert 曲线重新编号，
+    // 让相邻的点和道路在内存中也相邻
+    Map* ordered = map->createSpatiallyOrdered();
+    delete map;
+    return ordered;
 }
 
-std::vector<Point*> MapGenerator::generateRandomPoints() const {
+std::vector<Point*> MapGenerator::generateRandomPoints(Map* map) const {
     std::vector<Point*> points;
+    points.reserve(numPoints);
     std::random_device rd;
     std::mt19937 gen(rd());
     std::uniform_real_distribution<> xDist(0, mapWidth);
@@ -42,47 +79,62 @@ std::vector<Point*> MapGenerator::generateRandomPoints() const {
     for (int i = 0; i < numPoints; i++) {
         double x = xDist(gen);
         double y = yDist(gen);
-        points.push_back(new Point(i, x, y));
+        points.push_back(map->createPoint(x, y));
     }
     
     return points;
 }
 
-const int MAX_CONNECTIONS_PER_POINT = 3; // 定义每个点最多连接到最近的N个点
-
 void MapGenerator::createRoads(Map* map, std::vector<Point*>& points) const {
     // std::random_device rd; // 如果不再需要随机连接数，可以移除
     // std::mt19937 gen(rd()); // 如果不再需要随机连接数，可以移除
     // std::uniform_int_distribution<> connectionsDist(2, 5); // 每个点连接2-5条道路 - 这行将被修改或移除
     
-    int roadId = 0;
-    
     // 实现网格或四叉树来加速空间查询
     // 创建简单的网格索引
     const int gridSize = 50; // 网格大小
     const double cellWidth = mapWidth / gridSize;
     const double cellHeight = mapHeight / gridSize;
     
-    // 创建网格
-    std::vector<std::vector<std::vector<Point*>>> grid(gridSize, 
-        std::vector<std::vector<Point*>>(gridSize));
+    // 创建网格：按网格单元排序的点数组（类似CSR），每个单元的坐标以SoA形式连续存放，
+    // 便于用向量化内核一次计算整个单元到查询点的距离
+    const int numCells = gridSize * gridSize;
+    auto cellOf = [&](const Point* point) {
+        int gridX = std::min(gridSize - 1, std::max(0, static_cast<int>(point->getX() / cellWidth)));
+        int gridY = std::min(gridSize - 1, std::max(0, static_cast<int>(point->getY() / cellHeight)));
+        return gridX * gridSize + gridY;
+    };
+    
+    std::vector<int> cellStart(numCells + 1, 0);
+    for (auto point : points) {
+        cellStart[cellOf(point) + 1]++;
+    }
+    for (int c = 0; c < numCells; c++) {
+        cellStart[c + 1] += cellStart[c];
+    }
     
     // 将点放入网格
+    std::vector<Point*> cellPoints(points.size());
+    std::vector<double> cellXs(points.size());
+    std::vector<double> cellYs(points.size());
+    std::vector<int> cursor(cellStart.begin(), cellStart.end() - 1);
     for (auto point : points) {
-        int gridX = std::min(gridSize - 1, std::max(0, static_cast<int>(point->getX() / cellWidth)));
-        int gridY = std::min(gridSize - 1, std::max(0, static_cast<int>(point->getY() / cellHeight)));
-        grid[gridX][gridY].push_back(point);
+        int slot = cursor[cellOf(point)]++;
+        cellPoints[slot] = point;
+        cellXs[slot] = point->getX();
+        cellYs[slot] = point->getY();
     }
     
-    // 优化：批量处理道路创建，减少重复计算
-    std::vector<Road*> newRoads;
-    newRoads.reserve(points.size() * 3); // 预分配内存，假设平均每个点3条道路
+    const double maxDistanceSq = maxRoadDistance * maxRoadDistance;
+    std::vector<double> distanceSq; // 批量距离计算的输出缓冲区，循环中复用
+    std::vector<std::pair<Point*, double>> nearbyPoints;
     
     for (auto point : points) {
-        // 使用网格快速找到邻近点
-        std::vector<std::pair<Point*, double>> nearbyPoints;
-        int gridX = std::min(gridSize - 1, std::max(0, static_cast<int>(point->getX() / cellWidth)));
-        int gridY = std::min(gridSize - 1, std::max(0, static_cast<int>(point->getY() / cellHeight)));
+        // 使用网格快速找到邻近点（距离以平方形式比较和排序，与按距离排序等价）
+        nearbyPoints.clear();
+        int cell = cellOf(point);
+        int gridX = cell / gridSize;
+        int gridY = cell % gridSize;
         
         // 搜索当前网格和相邻网格
         for (int dx = -1; dx <= 1; dx++) {
@@ -91,12 +143,22 @@ void MapGenerator::createRoads(Map* map, std::vector<Point*>& points) const {
                 int ny = gridY + dy;
                 
                 if (nx >= 0 && nx < gridSize && ny >= 0 && ny < gridSize) {
-                    for (auto otherPoint : grid[nx][ny]) {
-                        if (point->getId() != otherPoint->getId()) {
-                            double distance = point->distanceTo(*otherPoint);
-                            if (distance <= maxRoadDistance) { // 确保在最大连接距离内
-                                nearbyPoints.push_back(std::make_pair(otherPoint, distance));
-                            }
+                    int neighborCell = nx * gridSize + ny;
+                    int begin = cellStart[neighborCell];
+                    int count = cellStart[neighborCell + 1] - begin;
+                    if (count == 0) {
+                        continue;
+                    }
+                    
+                    distanceSq.resize(count);
+                    GeometryKernels::squaredDistances(cellXs.data() + begin, cellYs.data() + begin, count,
+                                                      point->getX(), point->getY(), distanceSq.data());
+                    
+                    for (int j = 0; j < count; j++) {
+                        Point* otherPoint = cellPoints[begin + j];
+                        // 确保在最大连接距离内
+                        if (distanceSq[j] <= maxDistanceSq && point->getId() != otherPoint->getId()) {
+                            nearbyPoints.push_back(std::make_pair(otherPoint, distanceSq[j]));
                         }
                     }
                 }
@@ -120,31 +182,17 @@ void MapGenerator::createRoads(Map* map, std::vector<Point*>& points) const {
             
             // 检查是否已经存在连接 (双向检查，避免重复创建或只考虑一个方向)
             if (map->getRoadBetweenPoints(point->getId(), otherPoint->getId()) == nullptr) {
-                // 创建新道路
-                Road* newRoad = new Road(roadId++, point, otherPoint);
+                // 候选道路先在栈上构造，通过检查后才在地图中创建（被拒绝的道路不占用ID）
+                Road candidate(map->getNextRoadId(), point, otherPoint);
                 
                 // 检查是否有不合理的交叉
-                // 优化：hasInvalidIntersection 应该只检查与 *map中已有的* 道路的交叉
-                // 而不是与 newRoads 列表中的道路交叉，因为它们尚未添加到map中
-                bool hasIntersection = false;
-                // 收集所有已在地图中的道路用于交叉检查
-                std::vector<Road*> existingMapRoads = map->getAllRoads(); 
-                if (hasInvalidIntersection(*newRoad, existingMapRoads)) { // 传递 map->getAllRoads()
-                    hasIntersection = true;
-                }
-                for (auto road : map->getAllRoads()) {
-                    if (hasInvalidIntersection(*newRoad, {road})) {
-                        hasIntersection = true;
-                        break;
-                    }
-                }
+                // 只检查与 *map中已有的* 道路的交叉，直接在地图的道路视图上检查，避免复制道路列表
+                bool hasIntersection = hasInvalidIntersection(candidate, map->roadsView());
                 
                 // 如果没有不合理的交叉，添加道路
                 if (!hasIntersection) {
-                    map->addRoad(newRoad);
+                    map->createRoad(point, otherPoint);
                     connectionsCreated++;
-                } else {
-                    delete newRoad; // 清理不使用的道路
                 }
             }
         }
@@ -164,7 +212,7 @@ void MapGenerator::ensureConnectivity(Map* map) const {
     std::unordered_set<int> visited;
     std::vector<std::vector<int>> components;
     
-    for (auto point : map->getAllPoints()) {
+    for (Point* point : map->pointsView()) {
         int pointId = point->getId();
         
         // 如果该点已经被访问过，跳过
@@ -184,7 +232,7 @@ void MapGenerator::ensureConnectivity(Map* map) const {
             int currentId = queue.front();
             queue.pop();
             
-            for (auto adjPoint : map->getAdjacentPoints(currentId)) {
+            for (Point* adjPoint : map->adjacentPointsView(currentId)) {
                 int adjId = adjPoint->getId();
                 
                 if (visited.find(adjId) == visited.end()) {
@@ -199,8 +247,6 @@ void MapGenerator::ensureConnectivity(Map* map) const {
     }
     
     // 连接所有连通分量
-    int roadId = map->getAllRoads().size();
-    
     for (size_t i = 1; i < components.size(); i++) {
         // 从前一个分量中选择一个点
         int fromId = components[i-1][0];
@@ -211,12 +257,11 @@ void MapGenerator::ensureConnectivity(Map* map) const {
         Point* toPoint = map->getPointById(toId);
         
         // 创建连接这两个点的道路
-        Road* newRoad = new Road(roadId++, fromPoint, toPoint);
-        map->addRoad(newRoad);
+        map->createRoad(fromPoint, toPoint);
     }
 }
 
-bool MapGenerator::hasInvalidIntersection(const Road& newRoad, const std::vector<Road*>& existingRoads) const {
+bool MapGenerator::hasInvalidIntersection(const Road& newRoad, Span<Road*> existingRoads) const {
     // 优化：使用空间索引结构（如R树）来快速筛选可能相交的道路
     // 只检查与新道路可能相交的道路，而不是所有道路
     
@@ -3,6 +3,7 @@
 
 #include "../core/Map.h"
 #include <functional> // 添加这个头文件以支持 std::function
+#include <cstdint>
 
 class MapGenerator {
 private:
@@ -12,14 +13,20 @@ private:
     double maxRoadDistance;
     
 public:
+    // 生成算法版本，生成规则改变时递增，使旧的地图缓存失效
+    static const uint32_t GENERATOR_VERSION = 1;
+    
     MapGenerator(int numPoints, double width, double height, double maxRoadDistance);
     
+    // 生成参数（含算法版本）的哈希，用作地图缓存的来源参数键
+    uint64_t getParameterKey() const;
+    
     // 修改声明，添加 progressCallback 参数
     Map* generateMap(std::function<void(float)> progressCallback = nullptr) const;
     
 private:
-    // 随机生成点
-    std::vector<Point*> generateRandomPoints() const;
+    // 随机生成点，点对象直接创建在地图的竞技场中
+    std::vector<Point*> generateRandomPoints(Map* map) const;
     
     // 为每个点创建连接到附近点的道路
     void createRoads(Map* map, std::vector<Point*>& points) const;
@@ -28,7 +35,7 @@ private:
     void ensureConnectivity(Map* map) const;
     
     // 检查道路是否有不合理的交叉
-    bool hasInvalidIntersection(const Road& newRoad, const std::vector<Road*>& existingRoads) const;
+    bool hasInvalidIntersection(const Road& newRoad, Span<Road*> existingRoads) const;
     
     // 判断点是否在线段上
     bool onSegment(double x1, double y1, double x2, double y2, double x, double y) const;
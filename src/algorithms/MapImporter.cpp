@@ -0,0 +1,496 @@
+#include "MapImporter.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <thread>
+#include <unordered_map>
+
+#ifdef _WIN32
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#include <psapi.h>
+#else
+#include <sys/resource.h>
+#endif
+
+namespace {
+
+typedef MapImporter::Record Record;
+
+// 解析结果：1 得到一条记录，0 空行/注释/表头，-1 格式错误
+const int LINE_RECORD = 1;
+const int LINE_SKIP = 0;
+const int LINE_MALFORMED = -1;
+
+// 并行解析的最小块大小，太小的块不值得启动线程
+const size_t MIN_PARALLEL_BYTES = 256 * 1024;
+
+// 用于估计行数的样本大小
+const size_t LINE_SAMPLE_BYTES = 64 * 1024;
+
+size_t peakMemoryBytes() {
+#ifdef _WIN32
+    PROCESS_MEMORY_COUNTERS counters;
+    if (GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters))) {
+        return counters.PeakWorkingSetSize;
+    }
+    return 0;
+#else
+    struct rusage usage;
+    if (getrusage(RUSAGE_SELF, &usage) != 0) {
+        return 0;
+    }
+#ifdef __APPLE__
+    return static_cast<size_t>(usage.ru_maxrss);         // macOS 以字节为单位
+#else
+    return static_cast<size_t>(usage.ru_maxrss) * 1024;  // Linux 以KB为单位
+#endif
+#endif
+}
+
+// 跳过字段之间的空白和逗号，不会越过行尾
+inline const char* skipSeparators(const char* p, const char* end) {
+    while (p < end && (*p == ' ' || *p == '\t' || *p == ',' || *p == '\r')) {
+        ++p;
+    }
+    return p;
+}
+
+inline bool isDigit(char c) {
+    return c >= '0' && c <= '9';
+}
+
+// 在 [p, end) 内解析一个整数，成功时p移动到数字之后
+inline bool parseInteger(const char*& p, const char* end, long long& value) {
+    p = skipSeparators(p, end);
+    if (p >= end) {
+        return false;
+    }
+    bool negative = false;
+    if (*p == '-' || *p == '+') {
+        negative = (*p == '-');
+        ++p;
+    }
+    if (p >= end || !isDigit(*p)) {
+        return false;
+    }
+    long long result = 0;
+    while (p < end && isDigit(*p)) {
+        result = result * 10 + (*p - '0');
+        ++p;
+    }
+    value = negative ? -result : result;
+    return true;
+}
+
+// 在 [p, end) 内解析一个浮点数
+// 缓冲区中每行都以'\n'结尾，strtod 会在换行处停下，不会越界
+inline bool parseReal(const char*& p, const char* end, double& value) {
+    p = skipSeparators(p, end);
+    if (p >= end) {
+        return false;
+    }
+    char* stop = nullptr;
+    value = std::strtod(p, &stop);
+    if (stop == p || stop > end) {
+        return false;
+    }
+    p = stop;
+    return true;
+}
+
+// 跳过一个非数字单词（如DIMACS问题行中的 "sp"、"aux"）
+inline void skipWord(const char*& p, const char* end) {
+    p = skipSeparators(p, end);
+    while (p < end && *p != ' ' && *p != '\t' && *p != '\r') {
+        ++p;
+    }
+}
+
+int parseDimacsLine(const char* p, const char* end, Record& record) {
+    p = skipSeparators(p, end);
+    if (p >= end || *p == 'c') {
+        return LINE_SKIP;
+    }
+
+    char kind = *p++;
+    record.kind = kind;
+
+    if (kind == 'p') {
+        // "p sp <n> <m>" 或 "p aux sp co <n>"：跳过单词，读取其后的整数
+        record.a = -1;
+        record.b = -1;
+        while (p < end) {
+            const char* q = skipSeparators(p, end);
+            if (q >= end) break;
+            if (isDigit(*q)) {
+                long long value = 0;
+                parseInteger(q, end, value);
+                if (record.a < 0) record.a = value; else record.b = value;
+                p = q;
+            } else {
+                skipWord(q, end);
+                p = q;
+            }
+        }
+        return record.a >= 0 ? LINE_RECORD : LINE_MALFORMED;
+    }
+
+    if (kind == 'v') {
+        if (parseInteger(p, end, record.a) && parseReal(p, end, record.x) && parseReal(p, end, record.y)) {
+            return LINE_RECORD;
+        }
+        return LINE_MALFORMED;
+    }
+
+    if (kind == 'a') {
+        if (parseInteger(p, end, record.a) && parseInteger(p, end, record.b) && parseReal(p, end, record.x)) {
+            return LINE_RECORD;
+        }
+        return LINE_MALFORMED;
+    }
+
+    return LINE_MALFORMED;
+}
+
+// 表头行或空行：首个字符不是数字或符号
+inline bool isCsvHeaderOrBlank(const char* p, const char* end) {
+    p = skipSeparators(p, end);
+    return p >= end || !(isDigit(*p) || *p == '-' || *p == '+');
+}
+
+int parseCsvNodeLine(const char* p, const char* end, Record& record) {
+    if (isCsvHeaderOrBlank(p, end)) {
+        return LINE_SKIP;
+    }
+    record.kind = 'n';
+    if (parseInteger(p, end, record.a) && parseReal(p, end, record.x) && parseReal(p, end, record.y)) {
+        return LINE_RECORD;
+    }
+    return LINE_MALFORMED;
+}
+
+int parseCsvEdgeLine(const char* p, const char* end, Record& record) {
+    if (isCsvHeaderOrBlank(p, end)) {
+        return LINE_SKIP;
+    }
+    record.kind = 'e';
+    if (!parseInteger(p, end, record.a) || !parseInteger(p, end, record.b)) {
+        return LINE_MALFORMED;
+    }
+    // 容量列可选
+    if (!parseReal(p, end, record.x)) {
+        record.x = -1.0;
+    }
+    return LINE_RECORD;
+}
+
+// 解析 [begin, end) 中的所有完整行
+template<typename Parser>
+void parseSlice(const char* begin, const char* end, Parser parseLine,
+                std::vector<Record>& records, size_t& malformed) {
+    const char* line = begin;
+    while (line < end) {
+        const char* lineEnd = static_cast<const char*>(std::memchr(line, '\n', end - line));
+        if (!lineEnd) {
+            lineEnd = end;
+        }
+        Record record;
+        int result = parseLine(line, lineEnd, record);
+        if (result == LINE_RECORD) {
+            records.push_back(record);
+        } else if (result == LINE_MALFORMED) {
+            malformed++;
+        }
+        line = lineEnd + 1;
+    }
+}
+
+} // namespace
+
+MapImporter::MapImporter(int numThreads, size_t chunkSize)
+    : numThreads(numThreads), chunkSize(std::max<size_t>(chunkSize, 4096)) {
+    if (this->numThreads <= 0) {
+        this->numThreads = std::max(1u, std::thread::hardware_concurrency());
+    }
+}
+
+template<typename Parser, typename Consumer>
+bool MapImporter::streamRecords(const std::string& path, Parser parseLine, Consumer consume) {
+    std::ifstream in(path, std::ios::binary);
+    if (!in) {
+        std::cerr << "MapImporter: 无法打开文件 " << path << std::endl;
+        return false;
+    }
+
+    size_t capacity = chunkSize;
+    std::vector<char> buffer(capacity + 1); // 额外一字节用于补齐最后一行的换行符
+    std::vector<std::vector<Record>> threadRecords(numThreads);
+    std::vector<size_t> threadMalformed(numThreads, 0);
+    size_t carry = 0; // 上一块末尾不完整的行
+
+    while (true) {
+        in.read(buffer.data() + carry, static_cast<std::streamsize>(capacity - carry));
+        size_t got = static_cast<size_t>(in.gcount());
+        stats.bytesRead += got;
+        size_t filled = carry + got;
+        bool atEnd = (got < capacity - carry);
+
+        size_t usable;
+        if (atEnd) {
+            if (filled > 0 && buffer[filled - 1] != '\n') {
+                buffer[filled++] = '\n';
+            }
+            usable = filled;
+        } else {
+            const char* lastNewline = nullptr;
+            for (size_t i = filled; i > 0; i--) {
+                if (buffer[i - 1] == '\n') {
+                    lastNewline = buffer.data() + i - 1;
+                    break;
+                }
+            }
+            if (!lastNewline) {
+                // 单行比整块还长，扩大缓冲区后继续读取
+                capacity *= 2;
+                buffer.resize(capacity + 1);
+                carry = filled;
+                continue;
+            }
+            usable = static_cast<size_t>(lastNewline - buffer.data()) + 1;
+        }
+
+        // 在行边界处把可用数据切成若干片并行解析
+        const char* data = buffer.data();
+        int slices = (usable >= MIN_PARALLEL_BYTES) ? numThreads : 1;
+        std::vector<const char*> bounds(slices + 1);
+        bounds[0] = data;
+        bounds[slices] = data + usable;
+        for (int t = 1; t < slices; t++) {
+            const char* guess = std::max(bounds[t - 1], data + usable * t / slices);
+            const char* newline = static_cast<const char*>(std::memchr(guess, '\n', data + usable - guess));
+            bounds[t] = newline ? newline + 1 : data + usable;
+        }
+
+        std::vector<std::thread> workers;
+        for (int t = 0; t < slices; t++) {
+            threadRecords[t].clear();
+            threadMalformed[t] = 0;
+        }
+        for (int t = 1; t < slices; t++) {
+            workers.emplace_back([&, t]() {
+                parseSlice(bounds[t], bounds[t + 1], parseLine, threadRecords[t], threadMalformed[t]);
+            });
+        }
+        parseSlice(bounds[0], bounds[1], parseLine, threadRecords[0], threadMalformed[0]);
+        for (auto& worker : workers) {
+            worker.join();
+        }
+
+        // 按文件顺序写入结果
+        for (int t = 0; t < slices; t++) {
+            stats.malformedLines += threadMalformed[t];
+            for (const Record& record : threadRecords[t]) {
+                consume(record);
+            }
+        }
+
+        carry = filled - usable;
+        if (carry > 0) {
+            std::memmove(buffer.data(), buffer.data() + usable, carry);
+        }
+        if (atEnd) {
+            break;
+        }
+    }
+
+    return true;
+}
+
+bool MapImporter::readDimacsProblemLine(const std::string& graphPath, long long& numNodes, long long& numArcs) {
+    std::ifstream in(graphPath, std::ios::binary);
+    if (!in) {
+        std::cerr << "MapImporter: 无法打开文件 " << graphPath << std::endl;
+        return false;
+    }
+
+    // 问题行位于注释之后、弧之前，逐行读取直到找到为止
+    std::string line;
+    while (std::getline(in, line)) {
+        const char* p = line.data();
+        const char* end = p + line.size();
+        p = skipSeparators(p, end);
+        if (p < end && *p == 'p') {
+            Record record;
+            if (parseDimacsLine(p, end, record) == LINE_RECORD && record.b >= 0) {
+                numNodes = record.a;
+                numArcs = record.b;
+                return true;
+            }
+            break;
+        }
+        if (p < end && *p == 'a') {
+            break;
+        }
+    }
+
+    std::cerr << "MapImporter: 未找到问题行 \"p sp <n> <m>\" " << graphPath << std::endl;
+    return false;
+}
+
+size_t MapImporter::estimateLineCount(const std::string& path) {
+    std::ifstream in(path, std::ios::binary | std::ios::ate);
+    if (!in) {
+        return 0;
+    }
+    std::streamoff fileSize = in.tellg();
+    in.seekg(0);
+
+    std::vector<char> sample(LINE_SAMPLE_BYTES);
+    in.read(sample.data(), static_cast<std::streamsize>(sample.size()));
+    size_t sampled = static_cast<size_t>(in.gcount());
+    size_t lines = static_cast<size_t>(std::count(sample.begin(), sample.begin() + sampled, '\n'));
+    if (sampled == 0 || lines == 0) {
+        return 1;
+    }
+    return static_cast<size_t>(static_cast<double>(fileSize) * lines / sampled) + 1;
+}
+
+void MapImporter::finishStats(double seconds) {
+    stats.seconds = seconds;
+    stats.megabytesPerSecond = (seconds > 0.0) ? (stats.bytesRead / (1024.0 * 1024.0)) / seconds : 0.0;
+    stats.peakMemoryBytes = peakMemoryBytes();
+}
+
+Map* MapImporter::importDimacs(const std::string& graphPath, const std::string& coordinatePath) {
+    auto startTime = std::chrono::steady_clock::now();
+    stats = ImportStats();
+
+    long long numNodes = 0;
+    long long numArcs = 0;
+    if (!readDimacsProblemLine(graphPath, numNodes, numArcs) || numNodes <= 0 || numNodes > INT32_MAX) {
+        return nullptr;
+    }
+
+    // 先读坐标：点ID按文件中的ID减1确定，坐标行可以乱序
+    std::vector<double> xs(numNodes, 0.0);
+    std::vector<double> ys(numNodes, 0.0);
+    std::vector<char> hasCoordinate(numNodes, 0);
+    bool ok = streamRecords(coordinatePath, parseDimacsLine, [&](const Record& record) {
+        if (record.kind == 'v' && record.a >= 1 && record.a <= numNodes) {
+            xs[record.a - 1] = record.x;
+            ys[record.a - 1] = record.y;
+            hasCoordinate[record.a - 1] = 1;
+        } else if (record.kind != 'p') {
+            stats.malformedLines++;
+        }
+    });
+    if (!ok) {
+        return nullptr;
+    }
+
+    // DIMACS 中双向道路以两条弧出现，按弧数的一半预分配道路
+    Map* map = new Map();
+    map->reserveCapacity(static_cast<size_t>(numNodes), static_cast<size_t>(numArcs / 2 + 1));
+
+    std::vector<Point*> points(numNodes);
+    size_t missingCoordinates = 0;
+    for (long long i = 0; i < numNodes; i++) {
+        points[i] = map->createPoint(xs[i], ys[i]);
+        if (!hasCoordinate[i]) {
+            missingCoordinates++;
+        }
+    }
+    stats.nodesImported = points.size();
+    if (missingCoordinates > 0) {
+        std::cerr << "MapImporter: " << missingCoordinates << " 个点缺少坐标，已放在原点" << std::endl;
+    }
+
+    // 释放临时坐标
+    std::vector<double>().swap(xs);
+    std::vector<double>().swap(ys);
+    std::vector<char>().swap(hasCoordinate);
+
+    // 弧的权重（record.x）不使用，道路长度由两端坐标决定，见头文件中的说明
+    ok = streamRecords(graphPath, parseDimacsLine, [&](const Record& record) {
+        if (record.kind != 'a') {
+            return;
+        }
+        long long u = record.a - 1;
+        long long v = record.b - 1;
+        if (u < 0 || u >= numNodes || v < 0 || v >= numNodes || u == v ||
+            map->getRoadBetweenPoints(static_cast<int>(u), static_cast<int>(v))) {
+            stats.edgesSkipped++;
+            return;
+        }
+        map->createRoad(points[u], points[v]);
+        stats.edgesImported++;
+    });
+    if (!ok) {
+        delete map;
+        return nullptr;
+    }
+
+    map->freezeTopology();
+    finishStats(std::chrono::duration<double>(std::chrono::steady_clock::now() - startTime).count());
+    return map;
+}
+
+Map* MapImporter::importCsv(const std::string& nodesPath, const std::string& edgesPath) {
+    auto startTime = std::chrono::steady_clock::now();
+    stats = ImportStats();
+
+    // CSV 没有记录数，按文件开头的平均行长估计规模并预分配
+    size_t estimatedNodes = estimateLineCount(nodesPath);
+    size_t estimatedEdges = estimateLineCount(edgesPath);
+
+    Map* map = new Map();
+    map->reserveCapacity(estimatedNodes, estimatedEdges);
+
+    // 外部ID到稠密下标的映射
+    std::unordered_map<long long, int> externalToIndex;
+    externalToIndex.reserve(estimatedNodes);
+    std::vector<Point*> points;
+    points.reserve(estimatedNodes);
+
+    bool ok = streamRecords(nodesPath, parseCsvNodeLine, [&](const Record& record) {
+        if (externalToIndex.emplace(record.a, static_cast<int>(points.size())).second) {
+            points.push_back(map->createPoint(record.x, record.y));
+        } else {
+            stats.malformedLines++; // 重复的点ID
+        }
+    });
+    if (!ok || points.empty()) {
+        delete map;
+        return nullptr;
+    }
+    stats.nodesImported = points.size();
+
+    ok = streamRecords(edgesPath, parseCsvEdgeLine, [&](const Record& record) {
+        auto from = externalToIndex.find(record.a);
+        auto to = externalToIndex.find(record.b);
+        if (from == externalToIndex.end() || to == externalToIndex.end() || from->second == to->second ||
+            map->getRoadBetweenPoints(points[from->second]->getId(), points[to->second]->getId())) {
+            stats.edgesSkipped++;
+            return;
+        }
+        Road* road = map->createRoad(points[from->second], points[to->second]);
+        if (record.x > 0) {
+            road->setCapacity(static_cast<int>(record.x));
+        }
+        stats.edgesImported++;
+    });
+    if (!ok) {
+        delete map;
+        return nullptr;
+    }
+
+    map->freezeTopology();
+    finishStats(std::chrono::duration<double>(std::chrono::steady_clock::now() - startTime).count());
+    return map;
+}
@@ -0,0 +1,74 @@
+#ifndef MAP_IMPORTER_H
+#define MAP_IMPORTER_H
+
+#include "../core/Map.h"
+#include <string>
+#include <vector>
+#include <cstdint>
+
+// 导入统计信息
+struct ImportStats {
+    uint64_t bytesRead = 0;        // 读取的字节数
+    size_t nodesImported = 0;      // 导入的点数
+    size_t edgesImported = 0;      // 导入的道路数
+    size_t edgesSkipped = 0;       // 跳过的边（重复边、自环、端点不存在）
+    size_t malformedLines = 0;     // 无法解析的行
+    double seconds = 0.0;          // 总耗时
+    double megabytesPerSecond = 0.0;
+    size_t peakMemoryBytes = 0;    // 进程峰值内存（平台不支持时为0）
+};
+
+// 从外部文本格式流式导入大规模路网
+//
+// 支持的格式：
+//   DIMACS：.co 坐标文件（"v id x y"）和 .gr 图文件（"a u v w"），ID从1开始。
+//           弧是有向的，双向道路会出现两次，导入时合并为一条道路；
+//           道路长度按坐标计算，.gr 文件中弧的权重只做格式校验、不会写入地图：
+//           路径搜索把道路长度当作几何长度（A*以直线距离为下界，吸附按长度比例定位），
+//           而DIMACS权重通常是行驶时间或经过取整的距离，直接使用会破坏这些假设。
+//           因此导入后的最短路径与公开数据集给出的权重并不一致
+//   CSV：   点文件 "id,x,y"，边文件 "source,target[,capacity]"，首行表头可选。
+//           点ID可以是任意整数，导入后按文件顺序重新编号为稠密ID
+//
+// 文件按固定大小的块读取，每块在行边界处切分后由多个线程并行解析，
+// 解析直接在读缓冲上进行，不为每行创建临时字符串；解析结果按文件顺序写入地图
+class MapImporter {
+public:
+    // numThreads 为0时使用硬件线程数
+    explicit MapImporter(int numThreads = 0, size_t chunkSize = 8 * 1024 * 1024);
+
+    // 导入失败（文件无法打开或没有有效点）时返回 nullptr
+    Map* importDimacs(const std::string& graphPath, const std::string& coordinatePath);
+    Map* importCsv(const std::string& nodesPath, const std::string& edgesPath);
+
+    // 最近一次导入的统计信息，导入器本身不输出，由调用者决定是否打印
+    const ImportStats& getLastStats() const { return stats; }
+
+    // 一行解析出的记录，字段含义取决于类型
+    struct Record {
+        char kind;      // 'p' 问题行, 'v' 点, 'a' 弧, 'n' CSV点, 'e' CSV边
+        long long a;    // 点ID / 弧起点 / 问题行的点数
+        long long b;    // 弧终点 / 问题行的边数
+        double x;       // 坐标x / CSV边的容量（缺省为-1）
+        double y;       // 坐标y
+    };
+
+private:
+    int numThreads;
+    size_t chunkSize;
+    ImportStats stats;
+
+    // 按块流式读取文件，并行解析每块中的完整行，按文件顺序把记录交给 consume
+    template<typename Parser, typename Consumer>
+    bool streamRecords(const std::string& path, Parser parseLine, Consumer consume);
+
+    // 读取DIMACS图文件的问题行，用于预先确定点数和弧数
+    bool readDimacsProblemLine(const std::string& graphPath, long long& numNodes, long long& numArcs);
+
+    // 根据文件开头的样本估计行数
+    size_t estimateLineCount(const std::string& path);
+
+    void finishStats(double seconds);
+};
+
+#endif // MAP_IMPORTER_H
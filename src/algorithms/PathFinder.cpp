@@ -1,170 +1,372 @@
 #include "PathFinder.h"
-#include <queue>
-#include <unordered_map>
-#include <unordered_set>
 #include <limits>
 #include <algorithm>
+#include <cmath>
 
-PathFinder::PathFinder(Map* map) : map(map) {
+PathFinder::PathFinder(Map* map) : map(map), searchMode(SearchMode::AStar) {
 }
 
-std::vector<Point*> PathFinder::findShortestPath(int startPointId, int endPointId) const {
-    // 使用Dijkstra算法找最短路径
-    std::unordered_map<int, double> distance;
-    std::unordered_map<int, int> previous;
-    std::unordered_set<int> visited;
-    
-    // 优先队列，按距离排序
-    auto compare = [](const std::pair<int, double>& a, const std::pair<int, double>& b) {
-        return a.second > b.second;
+auto PathFinder::lengthWeight() const {
+    const double* lengths = map->roadLengthsView().data();
+    return [lengths](int road) { return lengths[road]; };
+}
+
+auto PathFinder::travelTimeWeight(double c, double threshold) const {
+    // 缓存与参数匹配时直接查表，否则逐条道路现场计算
+    const double* times = map->hasTravelTimes(c, threshold) ? map->travelTimesView().data() : nullptr;
+    Span<Road*> roads = map->roadsView();
+    return [times, roads, c, threshold](int road) {
+        return times ? times[road] : roads[road]->getTravelTime(c, threshold);
     };
-    std::priority_queue<std::pair<int, double>, 
-                        std::vector<std::pair<int, double>>, 
-                        decltype(compare)> queue(compare);
+}
+
+template<typename VisitFn>
+void PathFinder::forEachNeighbor(int node, VisitFn visit) const {
+    // 拓扑已冻结时在CSR上连续扫描邻居和道路下标，不经过ID查找
+    if (map->isTopologyFrozen()) {
+        const int* offsets = map->csrOffsetsView().data();
+        const int* neighbors = map->csrNeighborsView().data();
+        const int* roads = map->csrRoadsView().data();
+        for (int k = offsets[node]; k < offsets[node + 1]; k++) {
+            visit(neighbors[k], roads[k]);
+        }
+        return;
+    }
+    
+    // 冻结后又添加了道路：退回按ID组织的邻接表
+    Point* point = map->pointsView()[node];
+    for (Road* road : map->roadsFromPointView(point->getId())) {
+        Point* adjPoint = (road->getStartPoint() == point) ? road->getEndPoint() : road->getStartPoint();
+        int adjIndex = map->getPointIndex(adjPoint->getId());
+        int roadIndex = map->getRoadIndex(road->getId());
+        if (adjIndex >= 0 && roadIndex >= 0) {
+            visit(adjIndex, roadIndex);
+        }
+    }
+}
+
+template<typename WeightFn>
+int PathFinder::cheapestRoadBetween(int from, int to, WeightFn roadWeight) const {
+    int best = -1;
+    double bestWeight = std::numeric_limits<double>::infinity();
+    forEachNeighbor(from, [&](int adjIndex, int road) {
+        if (adjIndex == to && roadWeight(road) < bestWeight) {
+            bestWeight = roadWeight(road);
+            best = road;
+        }
+    });
+    return best;
+}
+
+template<typename WeightFn, typename HeuristicFn, typename SettleFn>
+size_t PathFinder::runSearch(SearchWorkspace& workspace, WeightFn roadWeight, HeuristicFn heuristic,
+                             SettleFn onSettle) const {
+    size_t settledCount = 0;
+    int current;
+    double priority;
     
-    // 初始化距离
-    for (auto point : map->getAllPoints()) {
-        int id = point->getId();
-        distance[id] = std::numeric_limits<double>::infinity();
-        previous[id] = -1;
+    while (workspace.popMin(current, priority)) {
+        workspace.settle(current);
+        settledCount++;
+        double currentCost = workspace.cost(current);
+        if (onSettle(current, currentCost)) {
+            break;
+        }
+        
+        forEachNeighbor(current, [&](int adjIndex, int road) {
+            if (workspace.isSettled(adjIndex)) {
+                return;
+            }
+            double newCost = currentCost + roadWeight(road);
+            if (newCost < workspace.cost(adjIndex)) {
+                workspace.relaxVia(adjIndex, newCost, current, road, newCost + heuristic(adjIndex));
+            }
+        });
     }
+    return settledCount;
+}
+
+template<typename WeightFn>
+int PathFinder::runBidirectionalSearch(SearchWorkspace& forward, SearchWorkspace& backward, int start, int end,
+                                       WeightFn roadWeight, size_t& settledCount) const {
+    settledCount = 0;
+    forward.relax(start, 0.0, -1);
+    backward.relax(end, 0.0, -1);
     
-    distance[startPointId] = 0;
-    queue.push(std::make_pair(startPointId, 0));
+    // 最佳相遇代价：某个点在两侧的代价之和的最小值，两侧任一代价更新时检查
+    double bestCost = (start == end) ? 0.0 : std::numeric_limits<double>::infinity();
+    int meeting = (start == end) ? start : -1;
     
-    while (!queue.empty()) {
-        int currentId = queue.top().first;
-        queue.pop();
+    for (;;) {
+        double forwardTop = forward.minPriority();
+        double backwardTop = backward.minPriority();
         
-        // 如果已经到达终点，结束搜索
-        if (currentId == endPointId) {
+        // 任何尚未确定的路线都要经过两侧堆中的点，代价不小于两个堆顶之和
+        if (forwardTop + backwardTop >= bestCost) {
             break;
         }
-        
-        // 如果已经访问过该点，跳过
-        if (visited.find(currentId) != visited.end()) {
-            continue;
+        if (forwardTop == std::numeric_limits<double>::infinity() &&
+            backwardTop == std::numeric_limits<double>::infinity()) {
+            break;
         }
         
-        visited.insert(currentId);
+        // 扩展堆顶较小的一侧，使两侧的搜索半径保持接近
+        bool expandForward = forwardTop <= backwardTop;
+        SearchWorkspace& side = expandForward ? forward : backward;
+        SearchWorkspace& other = expandForward ? backward : forward;
         
-        // 遍历所有相邻点
-        for (auto adjPoint : map->getAdjacentPoints(currentId)) {
-            int adjId = adjPoint->getId();
-            
-            // 如果已经访问过该点，跳过
-            if (visited.find(adjId) != visited.end()) {
-                continue;
+        int current;
+        double currentCost;
+        side.popMin(current, currentCost);
+        side.settle(current);
+        settledCount++;
+        
+        forEachNeighbor(current, [&](int adjIndex, int road) {
+            if (side.isSettled(adjIndex)) {
+                return;
             }
-            
-            // 获取连接两点的道路
-            Road* road = map->getRoadBetweenPoints(currentId, adjId);
-            if (!road) {
-                continue;
+            double newCost = currentCost + roadWeight(road);
+            if (side.relaxVia(adjIndex, newCost, current, road) && other.isReached(adjIndex) &&
+                newCost + other.cost(adjIndex) < bestCost) {
+                bestCost = newCost + other.cost(adjIndex);
+                meeting = adjIndex;
             }
-            
-            // 计算新的距离
-            double newDistance = distance[currentId] + road->getLength();
-            
-            // 如果找到更短的路径，更新距离和前驱
-            if (newDistance < distance[adjId]) {
-                distance[adjId] = newDistance;
-                previous[adjId] = currentId;
-                queue.push(std::make_pair(adjId, newDistance));
+        });
+    }
+    return meeting;
+}
+
+template<typename WeightFn>
+std::vector<Point*> PathFinder::findPointToPointPath(int startPointId, int endPointId, WeightFn roadWeight,
+                                                     double heuristicScale, SearchStats* stats,
+                                                     std::vector<Road*>* roads) const {
+    if (stats) {
+        *stats = SearchStats();
+    }
+    if (roads) {
+        roads->clear();
+    }
+    int start = map->getPointIndex(startPointId);
+    int end = map->getPointIndex(endPointId);
+    if (start < 0 || end < 0) {
+        return std::vector<Point*>();
+    }
+    
+    SearchWorkspace& workspace = SearchWorkspace::forCurrentThread();
+    workspace.begin(map->pointsView().size());
+    
+    if (searchMode == SearchMode::Bidirectional) {
+        SearchWorkspace& backward = SearchWorkspace::forCurrentThread(1);
+        backward.begin(map->pointsView().size());
+        size_t settledCount;
+        int meeting = runBidirectionalSearch(workspace, backward, start, end, roadWeight, settledCount);
+        if (stats) {
+            stats->settledNodes = settledCount;
+        }
+        if (meeting < 0) {
+            return std::vector<Point*>();
+        }
+        
+        // 前半段为正向树上起点到相遇点的路径，后半段沿反向树的前驱走到终点
+        Span<Point*> points = map->pointsView();
+        Span<Road*> allRoads = map->roadsView();
+        std::vector<Point*> path = buildPath(workspace, meeting, roads);
+        for (int at = meeting; backward.previous(at) != -1; at = backward.previous(at)) {
+            path.push_back(points[backward.previous(at)]);
+            if (roads) {
+                roads->push_back(allRoads[backward.previousRoad(at)]);
             }
         }
+        return path;
     }
     
-    // 重建路径
+    // 终点确定后即可结束搜索：启发值满足三角不等式，出堆时代价已是最小
+    auto reachedEnd = [end](int node, double) { return node == end; };
+    size_t settledCount;
+    // 收缩层次模式下层次结构不可用的查询退回A*
+    bool useAStar = searchMode == SearchMode::AStar || searchMode == SearchMode::ContractionHierarchy;
+    if (useAStar && heuristicScale > 0.0) {
+        const double* xs = map->xCoordinates().data();
+        const double* ys = map->yCoordinates().data();
+        double endX = xs[end];
+        double endY = ys[end];
+        double scale = heuristicScale * HEURISTIC_SLACK;
+        auto heuristic = [xs, ys, endX, endY, scale](int node) {
+            double dx = xs[node] - endX;
+            double dy = ys[node] - endY;
+            return scale * std::sqrt(dx * dx + dy * dy);
+        };
+        workspace.relax(start, 0.0, -1, heuristic(start));
+        settledCount = runSearch(workspace, roadWeight, heuristic, reachedEnd);
+    } else {
+        workspace.relax(start, 0.0, -1);
+        settledCount = runSearch(workspace, roadWeight, [](int) { return 0.0; }, reachedEnd);
+    }
+    
+    if (stats) {
+        stats->settledNodes = settledCount;
+    }
+    if (!workspace.isSettled(end)) {
+        return std::vector<Point*>();
+    }
+    return buildPath(workspace, end, roads);
+}
+
+std::vector<Point*> PathFinder::buildPath(const SearchWorkspace& workspace, int target, std::vector<Road*>* roads) const {
+    Span<Point*> points = map->pointsView();
+    Span<Road*> allRoads = map->roadsView();
     std::vector<Point*> path;
-    for (int at = endPointId; at != -1; at = previous[at]) {
-        path.push_back(map->getPointById(at));
+    size_t firstRoad = roads ? roads->size() : 0;
+    for (int at = target; at != -1; at = workspace.previous(at)) {
+        path.push_back(points[at]);
+        if (roads && workspace.previous(at) != -1) {
+            roads->push_back(allRoads[workspace.previousRoad(at)]);
+        }
     }
     
     // 反转路径，使其从起点到终点
     std::reverse(path.begin(), path.end());
+    if (roads) {
+        std::reverse(roads->begin() + firstRoad, roads->end());
+    }
+    return path;
+}
+
+template<typename Hierarchy, typename WeightFn>
+std::vector<Point*> PathFinder::findPathWithHierarchy(const Hierarchy& hierarchy, int startPointId, int endPointId,
+                                                      WeightFn roadWeight, SearchStats* stats,
+                                                      std::vector<Road*>* roads) const {
+    if (stats) {
+        *stats = SearchStats();
+    }
+    if (roads) {
+        roads->clear();
+    }
+    int start = map->getPointIndex(startPointId);
+    int end = map->getPointIndex(endPointId);
+    if (start < 0 || end < 0) {
+        return std::vector<Point*>();
+    }
     
+    std::vector<int> indices;
+    size_t settledCount = 0;
+    hierarchy.query(start, end, &indices, &settledCount);
+    if (stats) {
+        stats->settledNodes = settledCount;
+    }
+    
+    // 捷径已展开，相邻两点之间都有道路直接相连
+    Span<Point*> points = map->pointsView();
+    std::vector<Point*> path;
+    path.reserve(indices.size());
+    for (int index : indices) {
+        path.push_back(points[index]);
+    }
+    if (roads) {
+        Span<Road*> allRoads = map->roadsView();
+        for (size_t i = 1; i < indices.size(); i++) {
+            int road = cheapestRoadBetween(indices[i - 1], indices[i], roadWeight);
+            if (road >= 0) {
+                roads->push_back(allRoads[road]);
+            }
+        }
+    }
     return path;
 }
 
-std::vector<Point*> PathFinder::findFastestPath(int startPointId, int endPointId, double c, double threshold) const {
-    // 使用Dijkstra算法找最快路径，考虑路况
-    std::unordered_map<int, double> travelTime;
-    std::unordered_map<int, int> previous;
-    std::unordered_set<int> visited;
+std::vector<Point*> PathFinder::findShortestPath(int startPointId, int endPointId, SearchStats* stats,
+                                                 std::vector<Road*>* roads) const {
+    if (searchMode == SearchMode::ContractionHierarchy && map->isContractionHierarchyBuilt()) {
+        return findPathWithHierarchy(*map->getContractionHierarchy(), startPointId, endPointId, lengthWeight(),
+                                     stats, roads);
+    }
     
-    // 优先队列，按行驶时间排序
-    auto compare = [](const std::pair<int, double>& a, const std::pair<int, double>& b) {
-        return a.second > b.second;
-    };
-    std::priority_queue<std::pair<int, double>, 
-                        std::vector<std::pair<int, double>>, 
-                        decltype(compare)> queue(compare);
+    // 道路长度就是两端点的直线距离，直线距离本身即为下界
+    return findPointToPointPath(startPointId, endPointId, lengthWeight(), 1.0, stats, roads);
+}
+
+std::vector<Point*> PathFinder::findFastestPath(int startPointId, int endPointId, double c, double threshold,
+                                                SearchStats* stats, std::vector<Road*>* roads) const {
+    // 本交通时段的第一次查询负责按当前通行时间定制
+    if (searchMode == SearchMode::ContractionHierarchy && map->prepareCustomizableHierarchy(c, threshold)) {
+        return findPathWithHierarchy(*map->getCustomizableHierarchy(), startPointId, endPointId,
+                                     travelTimeWeight(c, threshold), stats, roads);
+    }
     
-    // 初始化行驶时间
-    for (auto point : map->getAllPoints()) {
-        int id = point->getId();
-        travelTime[id] = std::numeric_limits<double>::infinity();
-        previous[id] = -1;
+    // 考虑路况，优先读取当前交通时段的缓存；每单位长度的通行时间不小于 c * 最小拥堵因子
+    return findPointToPointPath(startPointId, endPointId, travelTimeWeight(c, threshold),
+                                c * map->getMinCongestionFactor(c, threshold), stats, roads);
+}
+
+template<typename WeightFn>
+SnappedRoute PathFinder::findSnappedRoute(const RoadSnap& from, const RoadSnap& to, WeightFn roadWeight) const {
+    SnappedRoute route;
+    if (!from.road || !to.road) {
+        return route;
     }
     
-    travelTime[startPointId] = 0;
-    queue.push(std::make_pair(startPointId, 0));
+    int fromStart = map->getPointIndex(from.road->getStartPoint()->getId());
+    int fromEnd = map->getPointIndex(from.road->getEndPoint()->getId());
+    int toStart = map->getPointIndex(to.road->getStartPoint()->getId());
+    int toEnd = map->getPointIndex(to.road->getEndPoint()->getId());
+    int fromRoad = map->getRoadIndex(from.road->getId());
+    int toRoad = map->getRoadIndex(to.road->getId());
+    if (fromStart < 0 || fromEnd < 0 || toStart < 0 || toEnd < 0 || fromRoad < 0 || toRoad < 0) {
+        return route;
+    }
     
-    while (!queue.empty()) {
-        int currentId = queue.top().first;
-        queue.pop();
-        
-        // 如果已经到达终点，结束搜索
-        if (currentId == endPointId) {
-            break;
+    double fromWeight = roadWeight(fromRoad);
+    double toWeight = roadWeight(toRoad);
+    
+    // 起终点在同一条道路上时可以直接沿道路行驶，经过路口的路线必须比它更短
+    double bestCost = std::numeric_limits<double>::infinity();
+    int bestExit = -1;
+    if (from.road == to.road) {
+        bestCost = std::abs(from.fraction - to.fraction) * fromWeight;
+    }
+    
+    // 起点所在道路的两个端点作为源点
+    SearchWorkspace& workspace = SearchWorkspace::forCurrentThread();
+    workspace.begin(map->pointsView().size());
+    workspace.relax(fromStart, from.fraction * fromWeight, -1);
+    workspace.relax(fromEnd, (1.0 - from.fraction) * fromWeight, -1);
+    
+    runSearch(workspace, roadWeight, [](int) { return 0.0; }, [&](int node, double nodeCost) {
+        // 剩余的点代价都不低于已知的最佳路线，结束搜索
+        if (nodeCost >= bestCost) {
+            return true;
         }
         
-        // 如果已经访问过该点，跳过
-        if (visited.find(currentId) != visited.end()) {
-            continue;
+        // 到达终点所在道路的端点：再沿该道路走到终点
+        if (node == toStart && nodeCost + to.fraction * toWeight < bestCost) {
+            bestCost = nodeCost + to.fraction * toWeight;
+            bestExit = node;
         }
-        
-        visited.insert(currentId);
-        
-        // 遍历所有相邻点
-        for (auto adjPoint : map->getAdjacentPoints(currentId)) {
-            int adjId = adjPoint->getId();
-            
-            // 如果已经访问过该点，跳过
-            if (visited.find(adjId) != visited.end()) {
-                continue;
-            }
-            
-            // 获取连接两点的道路
-            Road* road = map->getRoadBetweenPoints(currentId, adjId);
-            if (!road) {
-                continue;
-            }
-            
-            // 计算行驶时间，考虑路况
-            double roadTravelTime = road->getTravelTime(c, threshold);
-            double newTravelTime = travelTime[currentId] + roadTravelTime;
-            
-            // 如果找到更快的路径，更新时间和前驱
-            if (newTravelTime < travelTime[adjId]) {
-                travelTime[adjId] = newTravelTime;
-                previous[adjId] = currentId;
-                queue.push(std::make_pair(adjId, newTravelTime));
-            }
+        if (node == toEnd && nodeCost + (1.0 - to.fraction) * toWeight < bestCost) {
+            bestCost = nodeCost + (1.0 - to.fraction) * toWeight;
+            bestExit = node;
         }
-    }
+        return false;
+    });
     
-    // 重建路径
-    std::vector<Point*> path;
-    for (int at = endPointId; at != -1; at = previous[at]) {
-        path.push_back(map->getPointById(at));
+    if (bestCost == std::numeric_limits<double>::infinity()) {
+        return route;
     }
     
-    // 反转路径，使其从起点到终点
-    std::reverse(path.begin(), path.end());
-    
-    return path;
+    route.found = true;
+    route.cost = bestCost;
+    if (bestExit >= 0) {
+        route.points = buildPath(workspace, bestExit, &route.roads);
+    }
+    return route;
+}
+
+SnappedRoute PathFinder::findShortestPath(const RoadSnap& from, const RoadSnap& to) const {
+    return findSnappedRoute(from, to, lengthWeight());
+}
+
+SnappedRoute PathFinder::findFastestPath(const RoadSnap& from, const RoadSnap& to, double c, double threshold) const {
+    return findSnappedRoute(from, to, travelTimeWeight(c, threshold));
 }
 
 std::vector<Road*> PathFinder::getRoadsInPath(const std::vector<Point*>& path) const {
@@ -190,11 +392,12 @@ std::vector<Road*> PathFinder::getRoadsInPath(const std::vector<Point*>& path) c
 }
 
 double PathFinder::calculatePathLength(const std::vector<Point*>& path) const {
+    return calculatePathLength(getRoadsInPath(path));
+}
+
+double PathFinder::calculatePathLength(const std::vector<Road*>& roads) const {
     double totalLength = 0.0;
     
-    // 获取路径上的所有道路
-    std::vector<Road*> roads = getRoadsInPath(path);
-    
     // 累加所有道路的长度
     for (auto road : roads) {
         totalLength += road->getLength();
@@ -204,14 +407,15 @@ double PathFinder::calculatePathLength(const std::vector<Point*>& path) const {
 }
 
 double PathFinder::calculatePathTravelTime(const std::vector<Point*>& path, double c, double threshold) const {
+    return calculatePathTravelTime(getRoadsInPath(path), c, threshold);
+}
+
+double PathFinder::calculatePathTravelTime(const std::vector<Road*>& roads, double c, double threshold) const {
     double totalTime = 0.0;
     
-    // 获取路径上的所有道路
-    std::vector<Road*> roads = getRoadsInPath(path);
-    
     // 累加所有道路的行驶时间
     for (auto road : roads) {
-        totalTime += road->getTravelTime(c, threshold);
+        totalTime += map->getRoadTravelTime(road, c, threshold);
     }
     
     return totalTime;
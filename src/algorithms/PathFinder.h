@@ -5,28 +5,121 @@
 #include "../core/Map.h"
 #include "../core/Point.h"
 #include "../core/Road.h"
+#include "RoadSnapIndex.h"
+#include "SearchWorkspace.h"
+
+// 起终点位于道路中途的路线
+struct SnappedRoute {
+    bool found = false;
+    std::vector<Point*> points; // 途经的路口，从离开起点所在道路的端点到进入终点所在道路的端点；
+                                // 起终点在同一条道路上并直接沿该道路行驶时为空
+    std::vector<Road*> roads;   // points 中相邻路口之间依次经过的道路，不含首尾两条道路
+    double cost = 0.0;          // 总长度或总行驶时间，包含首尾两条道路上的部分
+};
+
+// 点到点查询使用的搜索算法
+enum class SearchMode {
+    Dijkstra,              // 从起点向四周均匀扩展
+    AStar,                 // 以到终点的直线距离为启发，优先向终点方向扩展
+    Bidirectional,         // 从起点和终点同时扩展，两侧相遇后结束
+    ContractionHierarchy   // 最短路径使用地图的收缩层次，最快路径使用按当前通行时间定制的可定制收缩层次；
+                           // 收缩层次需先构建，可定制收缩层次在第一次最快路径查询时构建；
+                           // 收缩层次未构建或通行时间缓存与参数不符时使用A*
+};
+
+// 一次搜索的统计信息
+struct SearchStats {
+    size_t settledNodes = 0;  // 最短代价被确定（出堆）的点数；可定制收缩层次为沿消去树向上松弛的点数
+};
 
 class PathFinder {
 private:
     Map* map;
+    SearchMode searchMode;
+    
+    // A*启发值的缩放余量：直线距离与道路长度用同样的公式计算，
+    // 略微缩小启发值以抵消浮点舍入，保证它不超过真实代价
+    static constexpr double HEURISTIC_SLACK = 1.0 - 1e-9;
+    
+    // 按道路下标读取长度/当前通行时间的代价函数，搜索的内层循环只做数组访问
+    auto lengthWeight() const;
+    auto travelTimeWeight(double c, double threshold) const;
+    
+    // 对稠密索引为 node 的点的每条道路调用 visit(另一端的稠密索引, 道路在 roadsView() 中的下标)
+    template<typename VisitFn>
+    void forEachNeighbor(int node, VisitFn visit) const;
+    
+    // 相邻两点之间代价最小的道路下标，没有道路时返回-1；层次结构只给出途经的点，按构建时的取法（平行道路取最小代价）还原道路
+    template<typename WeightFn>
+    int cheapestRoadBetween(int from, int to, WeightFn roadWeight) const;
+    
+    // 在点的稠密索引上运行最短路搜索，调用前由调用者开始工作区并放入源点。
+    // roadWeight(道路下标) 给出道路的代价，heuristic(index) 给出到终点代价的下界（Dijkstra 为0）；
+    // 每确定一个点调用 onSettle(index, cost)，返回 true 时停止搜索。返回确定的点数
+    template<typename WeightFn, typename HeuristicFn, typename SettleFn>
+    size_t runSearch(SearchWorkspace& workspace, WeightFn roadWeight, HeuristicFn heuristic, SettleFn onSettle) const;
+    
+    // 用预处理好的层次结构（ContractionHierarchy 或 CustomizableHierarchy）计算路径，找不到时返回空；
+    // roadWeight 为构建层次结构时使用的代价，用来还原途经的道路
+    template<typename Hierarchy, typename WeightFn>
+    std::vector<Point*> findPathWithHierarchy(const Hierarchy& hierarchy, int startPointId, int endPointId,
+                                              WeightFn roadWeight, SearchStats* stats, std::vector<Road*>* roads) const;
+    
+    // 两点之间代价最小的路径，找不到时返回空。roadWeight(道路下标) 给出道路的代价；
+    // A*模式下以 heuristicScale * 直线距离作为启发值，heuristicScale 不大于每单位长度的最小代价
+    template<typename WeightFn>
+    std::vector<Point*> findPointToPointPath(int startPointId, int endPointId, WeightFn roadWeight,
+                                             double heuristicScale, SearchStats* stats,
+                                             std::vector<Road*>* roads) const;
+    
+    // 双向Dijkstra：forward 从 start 出发，backward 从 end 出发，每次扩展堆顶较小的一侧，
+    // 两侧堆顶之和不小于已知的最佳相遇代价时停止。返回相遇点，找不到时返回-1
+    template<typename WeightFn>
+    int runBidirectionalSearch(SearchWorkspace& forward, SearchWorkspace& backward, int start, int end,
+                               WeightFn roadWeight, size_t& settledCount) const;
+    
+    // 沿工作区中的前驱链重建从源点到 target 的路径；roads 不为空时追加搜索时实际经过的道路
+    std::vector<Point*> buildPath(const SearchWorkspace& workspace, int target, std::vector<Road*>* roads = nullptr) const;
+    
+    // 多源Dijkstra：从起点所在道路的两个端点出发（初始代价为到端点的那一段），
+    // 到达终点所在道路的某个端点后加上剩余的一段；roadWeight(道路下标) 给出整条道路的代价
+    template<typename WeightFn>
+    SnappedRoute findSnappedRoute(const RoadSnap& from, const RoadSnap& to, WeightFn roadWeight) const;
     
 public:
     PathFinder(Map* map);
     
-    // 计算两点之间的最短路径（基于距离）
-    std::vector<Point*> findShortestPath(int startPointId, int endPointId) const;
+    // 点到点查询的搜索算法，默认为A*；两种算法得到的路径代价相同
+    void setSearchMode(SearchMode mode) { searchMode = mode; }
+    SearchMode getSearchMode() const { return searchMode; }
+    
+    // 计算两点之间的最短路径（基于距离），找不到路径时返回空
+    // 搜索状态保存在每个线程复用的稠密数组中，查询开销只与搜索到的点数有关；
+    // stats 不为空时写入本次搜索的统计信息，roads 不为空时写入路径依次经过的道路（两点间有平行道路时为搜索实际选中的那条）
+    std::vector<Point*> findShortestPath(int startPointId, int endPointId, SearchStats* stats = nullptr,
+                                         std::vector<Road*>* roads = nullptr) const;
+    
+    // 计算两点之间的最快路径（考虑路况），找不到路径时返回空
+    // A*的启发值为直线距离 * c * 最小拥堵因子；收缩层次模式下在地图的可定制收缩层次上查询，
+    // 第一次查询先构建它，通行时间更新后的第一次查询先按当前交通时段重新定制
+    std::vector<Point*> findFastestPath(int startPointId, int endPointId, double c, double threshold,
+                                        SearchStats* stats = nullptr, std::vector<Road*>* roads = nullptr) const;
     
-    // 计算两点之间的最快路径（考虑路况）
-    std::vector<Point*> findFastestPath(int startPointId, int endPointId, double c, double threshold) const;
+    // 从道路上的任意位置到另一位置的最短/最快路线，起终点通常由 Map::snapToRoad 得到
+    SnappedRoute findShortestPath(const RoadSnap& from, const RoadSnap& to) const;
+    SnappedRoute findFastestPath(const RoadSnap& from, const RoadSnap& to, double c, double threshold) const;
     
-    // 获取路径上的所有道路
+    // 获取路径上的所有道路：按相邻两点查找，两点间有平行道路时取最先添加的一条。
+    // 用于任意给定的点序列；搜索得到的路径应使用搜索通过 roads 参数返回的道路
     std::vector<Road*> getRoadsInPath(const std::vector<Point*>& path) const;
     
     // 计算路径总长度
     double calculatePathLength(const std::vector<Point*>& path) const;
+    double calculatePathLength(const std::vector<Road*>& roads) const;
     
     // 计算路径总行驶时间（考虑路况）
     double calculatePathTravelTime(const std::vector<Point*>& path, double c, double threshold) const;
+    double calculatePathTravelTime(const std::vector<Road*>& roads, double c, double threshold) const;
 };
 
 #endif // PATH_FINDER_H
\ No newline at end of file
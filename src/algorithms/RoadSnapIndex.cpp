@@ -0,0 +1,235 @@
+#include "RoadSnapIndex.h"
+#include "../core/SpaceFillingCurve.h"
+#include "../core/TaskPool.h"
+#include <algorithm>
+#include <cmath>
+
+RoadSnapIndex::RoadSnapIndex()
+    : originX(0.0), originY(0.0), cellSize(1.0), cellsX(0), cellsY(0), cellOffsets(1, 0) {
+}
+
+void RoadSnapIndex::appendSegment(Road* road) {
+    startXs.push_back(road->getStartPoint()->getX());
+    startYs.push_back(road->getStartPoint()->getY());
+    endXs.push_back(road->getEndPoint()->getX());
+    endYs.push_back(road->getEndPoint()->getY());
+    segmentRoads.push_back(road);
+}
+
+void RoadSnapIndex::build(const std::vector<Road*>& roads) {
+    startXs.clear();
+    startYs.clear();
+    endXs.clear();
+    endYs.clear();
+    segmentRoads.clear();
+    
+    startXs.reserve(roads.size());
+    startYs.reserve(roads.size());
+    endXs.reserve(roads.size());
+    endYs.reserve(roads.size());
+    segmentRoads.reserve(roads.size());
+    for (Road* road : roads) {
+        appendSegment(road);
+    }
+    rebuildGrid();
+}
+
+void RoadSnapIndex::insert(Road* road) {
+    appendSegment(road);
+    pendingSegments.push_back(static_cast<int>(segmentRoads.size()) - 1);
+    
+    // 待定列表每次查询都要线性扫描，长到与已索引部分成比例时重建，重建代价由这些插入分摊
+    if (pendingSegments.size() > static_cast<size_t>(MAX_PENDING_ROADS) &&
+        pendingSegments.size() * 8 > segmentRoads.size()) {
+        rebuildGrid();
+    }
+}
+
+void RoadSnapIndex::rebuildGrid() {
+    pendingSegments.clear();
+    cellSegments.clear();
+    const int numSegments = static_cast<int>(segmentRoads.size());
+    if (numSegments == 0) {
+        cellsX = cellsY = 0;
+        cellOffsets.assign(1, 0);
+        return;
+    }
+    
+    double minX = std::numeric_limits<double>::infinity();
+    double minY = std::numeric_limits<double>::infinity();
+    double maxX = -std::numeric_limits<double>::infinity();
+    double maxY = -std::numeric_limits<double>::infinity();
+    for (int s = 0; s < numSegments; s++) {
+        minX = std::min({minX, startXs[s], endXs[s]});
+        maxX = std::max({maxX, startXs[s], endXs[s]});
+        minY = std::min({minY, startYs[s], endYs[s]});
+        maxY = std::max({maxY, startYs[s], endYs[s]});
+    }
+    
+    // 单元数约为道路数 / TARGET_ROADS_PER_CELL；道路集中在一条线上时退化为一行或一列
+    double width = std::max(maxX - minX, 1e-9);
+    double height = std::max(maxY - minY, 1e-9);
+    double targetCells = std::max(1.0, static_cast<double>(numSegments) / TARGET_ROADS_PER_CELL);
+    cellSize = std::max(std::sqrt(width * height / targetCells), std::max(width, height) / targetCells);
+    originX = minX;
+    originY = minY;
+    cellsX = std::max(1, static_cast<int>(std::ceil(width / cellSize)));
+    cellsY = std::max(1, static_cast<int>(std::ceil(height / cellSize)));
+    
+    // 第一遍：统计每个单元登记的线段数
+    cellOffsets.assign(static_cast<size_t>(cellsX) * cellsY + 1, 0);
+    for (int s = 0; s < numSegments; s++) {
+        int c0 = cellColumn(std::min(startXs[s], endXs[s]));
+        int c1 = cellColumn(std::max(startXs[s], endXs[s]));
+        int r0 = cellRow(std::min(startYs[s], endYs[s]));
+        int r1 = cellRow(std::max(startYs[s], endYs[s]));
+        for (int r = r0; r <= r1; r++) {
+            for (int c = c0; c <= c1; c++) {
+                cellOffsets[static_cast<size_t>(r) * cellsX + c + 1]++;
+            }
+        }
+    }
+    
+    // 前缀和得到每个单元的区间
+    for (size_t c = 1; c < cellOffsets.size(); c++) {
+        cellOffsets[c] += cellOffsets[c - 1];
+    }
+    
+    // 第二遍：按线段编号顺序填充
+    cellSegments.assign(cellOffsets.back(), 0);
+    std::vector<int> cursor(cellOffsets.begin(), cellOffsets.end() - 1);
+    for (int s = 0; s < numSegments; s++) {
+        int c0 = cellColumn(std::min(startXs[s], endXs[s]));
+        int c1 = cellColumn(std::max(startXs[s], endXs[s]));
+        int r0 = cellRow(std::min(startYs[s], endYs[s]));
+        int r1 = cellRow(std::max(startYs[s], endYs[s]));
+        for (int r = r0; r <= r1; r++) {
+            for (int c = c0; c <= c1; c++) {
+                cellSegments[cursor[static_cast<size_t>(r) * cellsX + c]++] = s;
+            }
+        }
+    }
+}
+
+int RoadSnapIndex::cellColumn(double x) const {
+    double column = std::floor((x - originX) / cellSize);
+    return static_cast<int>(std::max(0.0, std::min(column, static_cast<double>(cellsX - 1))));
+}
+
+int RoadSnapIndex::cellRow(double y) const {
+    double row = std::floor((y - originY) / cellSize);
+    return static_cast<int>(std::max(0.0, std::min(row, static_cast<double>(cellsY - 1))));
+}
+
+void RoadSnapIndex::testSegment(int segment, double x, double y,
+                                double& bestDistSq, int& bestSegment, double& bestT) const {
+    double ax = startXs[segment];
+    double ay = startYs[segment];
+    double dx = endXs[segment] - ax;
+    double dy = endYs[segment] - ay;
+    
+    // 查询点在线段所在直线上的投影参数，截断到线段内
+    double lengthSq = dx * dx + dy * dy;
+    double t = (lengthSq > 0.0) ? ((x - ax) * dx + (y - ay) * dy) / lengthSq : 0.0;
+    t = std::max(0.0, std::min(t, 1.0));
+    
+    double px = ax + t * dx - x;
+    double py = ay + t * dy - y;
+    double distSq = px * px + py * py;
+    if (distSq < bestDistSq) {
+        bestDistSq = distSq;
+        bestSegment = segment;
+        bestT = t;
+    }
+}
+
+RoadSnap RoadSnapIndex::snapToRoad(double x, double y, double maxDistance) const {
+    RoadSnap result;
+    if (empty() || !(maxDistance >= 0)) {
+        return result;
+    }
+    
+    // 恰好等于 maxDistance 的道路也算命中
+    double bestDistSq = std::nextafter(maxDistance * maxDistance, std::numeric_limits<double>::infinity());
+    int bestSegment = -1;
+    double bestT = 0.0;
+    
+    for (int segment : pendingSegments) {
+        testSegment(segment, x, y, bestDistSq, bestSegment, bestT);
+    }
+    
+    if (cellsX > 0) {
+        int cx = cellColumn(x);
+        int cy = cellRow(y);
+        int maxRing = std::max({cx, cellsX - 1 - cx, cy, cellsY - 1 - cy});
+        for (int ring = 0; ring <= maxRing; ring++) {
+            if (ring > 0) {
+                // 第 ring 圈及以外的单元都在前面各圈围成的方块之外，
+                // 其中的线段到查询点的距离不小于查询点到方块边界的距离
+                double left = x - (originX + (cx - ring + 1) * cellSize);
+                double right = originX + (cx + ring) * cellSize - x;
+                double bottom = y - (originY + (cy - ring + 1) * cellSize);
+                double top = originY + (cy + ring) * cellSize - y;
+                double bound = std::min({left, right, bottom, top});
+                if (bound > 0.0 && bound * bound >= bestDistSq) {
+                    break;
+                }
+            }
+    
+            for (int r = cy - ring; r <= cy + ring; r++) {
+                if (r < 0 || r >= cellsY) {
+                    continue;
+                }
+                // 上下两行取整行，中间各行只取左右两端的单元
+                bool edgeRow = (r == cy - ring || r == cy + ring);
+                int step = edgeRow ? 1 : std::max(1, 2 * ring);
+                for (int c = cx - ring; c <= cx + ring; c += step) {
+                    if (c < 0 || c >= cellsX) {
+                        continue;
+                    }
+                    size_t cell = static_cast<size_t>(r) * cellsX + c;
+                    for (int i = cellOffsets[cell]; i < cellOffsets[cell + 1]; i++) {
+                        testSegment(cellSegments[i], x, y, bestDistSq, bestSegment, bestT);
+                    }
+                }
+            }
+        }
+    }
+    
+    if (bestSegment < 0) {
+        return result;
+    }
+    result.road = segmentRoads[bestSegment];
+    result.x = startXs[bestSegment] + bestT * (endXs[bestSegment] - startXs[bestSegment]);
+    result.y = startYs[bestSegment] + bestT * (endYs[bestSegment] - startYs[bestSegment]);
+    result.distance = std::sqrt(bestDistSq);
+    result.fraction = bestT;
+    result.offset = bestT * result.road->getLength();
+    return result;
+}
+
+void RoadSnapIndex::snapToRoadBatch(const double* xs, const double* ys, size_t numQueries, RoadSnap* out,
+                                    double maxDistance, bool parallel) const {
+    std::vector<uint32_t> order;
+    SpaceFillingCurve::mortonOrder(xs, ys, numQueries, order);
+    
+    auto runQueries = [&](size_t begin, size_t end) {
+        for (size_t i = begin; i < end; i++) {
+            uint32_t query = order[i];
+            out[query] = snapToRoad(xs[query], ys[query], maxDistance);
+        }
+    };
+    
+    TaskPool& pool = TaskPool::shared();
+    if (parallel && pool.getThreadCount() > 1) {
+        pool.parallelFor(0, numQueries, BATCH_QUERY_GRAIN, runQueries);
+    } else {
+        runQueries(0, numQueries);
+    }
+}
+
+size_t RoadSnapIndex::memoryUsage() const {
+    return (startXs.capacity() + startYs.capacity() + endXs.capacity() + endYs.capacity()) * sizeof(double) +
+           segmentRoads.capacity() * sizeof(Road*) +
+           (cellOffsets.capacity() + cellSegments.capacity() + pendingSegments.capacity()) * sizeof(int);
+}
@@ -0,0 +1,96 @@
+#ifndef ROAD_SNAP_INDEX_H
+#define ROAD_SNAP_INDEX_H
+
+#include <vector>
+#include <cstddef>
+#include <limits>
+#include "../core/Road.h"
+
+// 道路吸附的结果：道路上离查询点最近的位置
+struct RoadSnap {
+    Road* road = nullptr;    // 最近的道路，没有找到时为空
+    double x = 0.0;          // 道路上的最近位置
+    double y = 0.0;
+    double distance = std::numeric_limits<double>::infinity(); // 查询点到最近位置的距离
+    double offset = 0.0;     // 最近位置沿道路到起点的距离
+    double fraction = 0.0;   // offset 占道路长度的比例，范围 [0, 1]
+};
+
+// 道路线段的均匀网格索引，用于把GPS定位、点击位置吸附到最近的道路上
+//
+// 每条道路按包围盒登记到它覆盖的所有网格单元中，单元内容以CSR形式连续存放：
+// 单元c的线段下标位于 cellSegments[cellOffsets[c], cellOffsets[c + 1])。
+// 查询从查询点所在单元开始一圈圈向外扩展，已找到的最近距离不超过下一圈的距离下界时停止。
+// 线段端点坐标以结构数组的形式内联保存，查询时不需要解引用 Road/Point
+class RoadSnapIndex {
+public:
+    // 网格分辨率按平均每个单元登记的道路数确定
+    static constexpr int TARGET_ROADS_PER_CELL = 4;
+    
+    // 构建后新加入的道路先放在待定列表中线性扫描，超过该数量且超过已索引道路的1/8时重建网格
+    static constexpr int MAX_PENDING_ROADS = 64;
+    
+    // 批量查询时每个并行任务至少处理的查询数
+    static constexpr int BATCH_QUERY_GRAIN = 256;
+
+private:
+    // 线段端点和对应的道路，下标即线段编号
+    std::vector<double> startXs;
+    std::vector<double> startYs;
+    std::vector<double> endXs;
+    std::vector<double> endYs;
+    std::vector<Road*> segmentRoads;
+    
+    // 网格：原点、单元边长和单元数
+    double originX;
+    double originY;
+    double cellSize;
+    int cellsX;
+    int cellsY;
+    std::vector<int> cellOffsets;      // 长度为单元数+1
+    std::vector<int> cellSegments;     // 各单元登记的线段编号
+    
+    // 构建网格之后加入、尚未登记到网格的线段编号
+    std::vector<int> pendingSegments;
+    
+    // 追加一条线段（不登记到网格）
+    void appendSegment(Road* road);
+    
+    // 按当前所有线段重新划分网格并登记
+    void rebuildGrid();
+    
+    // 坐标所在的单元列/行，超出网格时截断到边界单元
+    int cellColumn(double x) const;
+    int cellRow(double y) const;
+    
+    // 用第 segment 条线段更新最近结果
+    void testSegment(int segment, double x, double y, double& bestDistSq, int& bestSegment, double& bestT) const;
+
+public:
+    RoadSnapIndex();
+    
+    // 用给定的道路构建索引
+    void build(const std::vector<Road*>& roads);
+    
+    // 加入一条道路，均摊代价与网格大小无关
+    void insert(Road* road);
+    
+    bool empty() const { return segmentRoads.empty(); }
+    size_t size() const { return segmentRoads.size(); }
+    
+    // 查找离 (x, y) 最近的道路及其上的最近位置；超过 maxDistance 的道路不考虑，
+    // 没有找到时返回的 road 为空
+    RoadSnap snapToRoad(double x, double y,
+                        double maxDistance = std::numeric_limits<double>::infinity()) const;
+    
+    // 批量吸附：out[i] 为第i个查询点的结果（容量至少为 numQueries）。
+    // 查询先按 Morton 序排列再执行，parallel 为 true 时在共享线程池上分块并行
+    void snapToRoadBatch(const double* xs, const double* ys, size_t numQueries, RoadSnap* out,
+                         double maxDistance = std::numeric_limits<double>::infinity(),
+                         bool parallel = true) const;
+    
+    // 索引占用的字节数（不含 vector 对象本身）
+    size_t memoryUsage() const;
+};
+
+#endif // ROAD_SNAP_INDEX_H
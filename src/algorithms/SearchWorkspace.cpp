@@ -0,0 +1,69 @@
+#include "SearchWorkspace.h"
+#include <algorithm>
+#include <functional>
+
+SearchWorkspace::SearchWorkspace() : generation(0) {
+}
+
+void SearchWorkspace::begin(size_t numNodes) {
+    if (nodes.size() < numNodes) {
+        nodes.resize(numNodes, NodeState{0.0, -1, -1, 0, 0});
+    }
+    
+    // 代次回绕到0时所有旧状态可能重新"有效"，整体清零一次
+    if (++generation == 0) {
+        std::fill(nodes.begin(), nodes.end(), NodeState{0.0, -1, -1, 0, 0});
+        generation = 1;
+    }
+    heap.clear();
+}
+
+bool SearchWorkspace::update(int node, double newCost, int previousNode, int road) {
+    NodeState& state = nodes[node];
+    if (state.reached == generation && newCost >= state.cost) {
+        return false;
+    }
+    state.cost = newCost;
+    state.previous = previousNode;
+    state.previousRoad = road;
+    state.reached = generation;
+    return true;
+}
+
+bool SearchWorkspace::relaxVia(int node, double newCost, int previousNode, int road, double priority) {
+    if (!update(node, newCost, previousNode, road)) {
+        return false;
+    }
+    heap.emplace_back(priority, node);
+    std::push_heap(heap.begin(), heap.end(), std::greater<std::pair<double, int>>());
+    return true;
+}
+
+bool SearchWorkspace::popMin(int& node, double& priority) {
+    while (!heap.empty()) {
+        std::pop_heap(heap.begin(), heap.end(), std::greater<std::pair<double, int>>());
+        std::pair<double, int> top = heap.back();
+        heap.pop_back();
+        
+        // 跳过已确定点的过期条目
+        if (!isSettled(top.second)) {
+            priority = top.first;
+            node = top.second;
+            return true;
+        }
+    }
+    return false;
+}
+
+double SearchWorkspace::minPriority() {
+    while (!heap.empty() && isSettled(heap.front().second)) {
+        std::pop_heap(heap.begin(), heap.end(), std::greater<std::pair<double, int>>());
+        heap.pop_back();
+    }
+    return heap.empty() ? std::numeric_limits<double>::infinity() : heap.front().first;
+}
+
+SearchWorkspace& SearchWorkspace::forCurrentThread(int slot) {
+    thread_local SearchWorkspace workspaces[WORKSPACES_PER_THREAD];
+    return workspaces[slot];
+}
@@ -0,0 +1,83 @@
+#ifndef SEARCH_WORKSPACE_H
+#define SEARCH_WORKSPACE_H
+
+#include <vector>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <utility>
+
+// 图搜索的可复用工作区：按点的稠密索引存放代价、前驱和已确定标记，并自带一个二叉堆
+//
+// 每个状态记录写入时的代次(generation)，与当前代次相同才有效。开始新搜索时只需递增代次，
+// 不用清空数组，所以一次查询的开销只与它实际访问的点数有关，而与地图规模无关。
+// 工作区按线程复用（见 forCurrentThread），不同线程可以同时搜索同一张地图
+class SearchWorkspace {
+public:
+    // 每个线程的工作区个数，双向搜索的两个方向各用一个
+    static constexpr int WORKSPACES_PER_THREAD = 2;
+
+private:
+    struct NodeState {
+        double cost;
+        int previous;
+        int previousRoad;  // 从前驱到达该点所经道路在 Map::roadsView() 中的下标，未记录时为-1
+        uint32_t reached;  // 等于当前代次时 cost/previous/previousRoad 有效
+        uint32_t settled;  // 等于当前代次时该点的最短代价已确定
+    };
+    
+    std::vector<NodeState> nodes;
+    uint32_t generation;
+    
+    // 小顶堆：(优先级, 稠密索引)，允许同一个点有多个过期条目
+    std::vector<std::pair<double, int>> heap;
+
+public:
+    SearchWorkspace();
+    
+    // 开始一次新的搜索：保证可以容纳 numNodes 个点，使之前的所有状态失效并清空堆
+    void begin(size_t numNodes);
+    
+    bool isReached(int node) const { return nodes[node].reached == generation; }
+    bool isSettled(int node) const { return nodes[node].settled == generation; }
+    
+    // 当前已知的代价，未到达时为无穷大
+    double cost(int node) const {
+        return isReached(node) ? nodes[node].cost : std::numeric_limits<double>::infinity();
+    }
+    
+    // 最短路径树上的前驱，源点或未到达时为-1
+    int previous(int node) const { return isReached(node) ? nodes[node].previous : -1; }
+    
+    // 从前驱到达 node 所经的道路下标，源点、未到达或未记录道路时为-1
+    int previousRoad(int node) const { return isReached(node) ? nodes[node].previousRoad : -1; }
+    
+    // 以 previous 为前驱、代价 newCost 到达 node；比已知代价更小时更新并以 priority 入堆，返回是否更新。
+    // Dijkstra 的优先级就是代价，A* 的优先级为代价加上到终点的估计
+    bool relax(int node, double newCost, int previousNode, double priority) {
+        return relaxVia(node, newCost, previousNode, -1, priority);
+    }
+    bool relax(int node, double newCost, int previousNode) { return relaxVia(node, newCost, previousNode, -1, newCost); }
+    
+    // 同 relax，同时记下经过的道路 road：两点间有平行道路时，重建路径靠它得到搜索实际松弛的那一条
+    bool relaxVia(int node, double newCost, int previousNode, int road, double priority);
+    bool relaxVia(int node, double newCost, int previousNode, int road) {
+        return relaxVia(node, newCost, previousNode, road, newCost);
+    }
+    
+    // 同 relax，但不入堆：按固定顺序扫描、不需要优先队列的搜索使用（如沿消去树向上的查询）
+    bool update(int node, double newCost, int previousNode, int road = -1);
+    
+    void settle(int node) { nodes[node].settled = generation; }
+    
+    // 弹出堆中优先级最小的未确定点，堆空时返回 false
+    bool popMin(int& node, double& priority);
+    
+    // 堆中未确定点的最小优先级（先丢弃堆顶的过期条目），堆空时为无穷大
+    double minPriority();
+    
+    // 当前线程的第 slot 个工作区（0 <= slot < WORKSPACES_PER_THREAD）
+    static SearchWorkspace& forCurrentThread(int slot = 0);
+};
+
+#endif // SEARCH_WORKSPACE_H
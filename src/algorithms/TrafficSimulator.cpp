@@ -8,6 +8,8 @@
 
 TrafficSimulator::TrafficSimulator(Map* map, double c, double threshold)
     : map(map), currentTime(0.0), c(c), threshold(threshold) {
+    // 计算初始时段的道路通行时间
+    map->updateTravelTimes(c, threshold);
 }
 
 TrafficSimulator::~TrafficSimulator() {
@@ -22,10 +24,11 @@ void TrafficSimulator::addCar(int startPointId, int endPointId) {
     PathFinder pathFinder(map);
     
     // 计算从起点到终点的最短路径
-    std::vector<Point*> path = pathFinder.findShortestPath(startPointId, endPointId);
+    std::vector<Road*> roads;
+    std::vector<Point*> path = pathFinder.findShortestPath(startPointId, endPointId, nullptr, &roads);
     
     // 如果找不到路径，直接返回
-    if (path.size() < 2) {
+    if (path.size() < 2 || roads.size() != path.size() - 1) {
         return;
     }
     
@@ -33,17 +36,18 @@ void TrafficSimulator::addCar(int startPointId, int endPointId) {
     Car* car = new Car();
     car->id = cars.size(); // 使用当前车辆数量作为ID
     car->path = path;
+    car->roads = roads;
     car->currentRoadIndex = 0;
     car->entryTime = currentTime;
     
     // 更新第一条道路的车流量
-    Road* firstRoad = map->getRoadBetweenPoints(path[0]->getId(), path[1]->getId());
-    if (firstRoad) {
-        firstRoad->setCurrentCars(firstRoad->getCurrentCars() + 1);
-    }
+    roads[0]->addCurrentCars(1);
     
     // 添加车辆到模拟中
     cars.push_back(car);
+    
+    // 车流量变了，刷新缓存的通行时间，使之后的最快路径查询（及可定制收缩层次的定制）立即看到这辆车
+    map->updateTravelTimes(c, threshold);
 }
 
 void TrafficSimulator::simulateTimeStep(double timeStep) {
@@ -61,24 +65,16 @@ void TrafficSimulator::simulateTimeStep(double timeStep) {
             continue;
         }
         
-        // 获取当前道路
-        int startId = car->path[car->currentRoadIndex]->getId();
-        int endId = car->path[car->currentRoadIndex + 1]->getId();
-        Road* currentRoad = map->getRoadBetweenPoints(startId, endId);
-        
-        if (!currentRoad) {
-            // 如果找不到道路，跳过这辆车
-            ++it;
-            continue;
-        }
+        // 获取当前道路：规划时选中的那条，两点间有平行道路时也不会记到别的道路上
+        Road* currentRoad = car->roads[car->currentRoadIndex];
         
         // 计算通过当前道路所需的时间
-        double travelTime = currentRoad->getTravelTime(c, threshold);
+        double travelTime = map->getRoadTravelTime(currentRoad, c, threshold);
         
         // 如果已经通过当前道路
         if (currentTime - car->entryTime >= travelTime) {
             // 减少当前道路的车流量
-            currentRoad->setCurrentCars(currentRoad->getCurrentCars() - 1);
+            currentRoad->addCurrentCars(-1);
             
             // 移动到下一条道路
             car->currentRoadIndex++;
@@ -86,18 +82,15 @@ void TrafficSimulator::simulateTimeStep(double timeStep) {
             
             // 如果还没到达终点，增加下一条道路的车流量
             if (car->currentRoadIndex < car->path.size() - 1) {
-                int nextStartId = car->path[car->currentRoadIndex]->getId();
-                int nextEndId = car->path[car->currentRoadIndex + 1]->getId();
-                Road* nextRoad = map->getRoadBetweenPoints(nextStartId, nextEndId);
-                
-                if (nextRoad) {
-                    nextRoad->setCurrentCars(nextRoad->getCurrentCars() + 1);
-                }
+                car->roads[car->currentRoadIndex]->addCurrentCars(1);
             }
         }
         
         ++it;
     }
+    
+    // 车辆移动完成，进入新的交通时段：整批重算通行时间
+    map->updateTravelTimes(c, threshold);
 }
 
 double TrafficSimulator::getCurrentTime() const {
@@ -127,13 +120,11 @@ std::vector<std::pair<int, std::shared_ptr<Point>>> TrafficSimulator::getAllCarP
         // 如果车辆在道路上
         if (car->currentRoadIndex < car->path.size() - 1) {
             // 获取当前道路
-            int startId = car->path[car->currentRoadIndex]->getId();
-            int endId = car->path[car->currentRoadIndex + 1]->getId();
-            Road* road = map->getRoadBetweenPoints(startId, endId);
+            Road* road = car->roads[car->currentRoadIndex];
             
             if (road) {
                 // 计算车辆在道路上的位置
-                double travelTime = road->getTravelTime(c, threshold);
+                double travelTime = map->getRoadTravelTime(road, c, threshold);
                 double timeOnRoad = currentTime - car->entryTime;
                 double progress = std::min(1.0, timeOnRoad / travelTime);
                 
@@ -157,4 +148,13 @@ std::vector<std::pair<int, std::shared_ptr<Point>>> TrafficSimulator::getAllCarP
 
 void TrafficSimulator::setThreshold(double newThreshold) {
     threshold = newThreshold;
+    map->updateTravelTimes(c, threshold);
+}
+
+double TrafficSimulator::getC() const {
+    return c;
+}
+
+double TrafficSimulator::getThreshold() const {
+    return threshold;
 }
\ No newline at end of file
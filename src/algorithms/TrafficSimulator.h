@@ -10,6 +10,7 @@
 struct Car {
     int id;
     std::vector<Point*> path;
+    std::vector<Road*> roads; // path 中相邻两点之间行驶的道路，roads[i] 连接 path[i] 和 path[i + 1]
     int currentRoadIndex;
     double entryTime; // 进入当前道路的时间
 };
@@ -26,10 +27,10 @@ public:
     TrafficSimulator(Map* map, double c, double threshold);
     ~TrafficSimulator();
     
-    // 添加一辆新车，指定起点和终点
+    // 添加一辆新车，指定起点和终点；车辆进入第一条道路后重算地图中缓存的道路通行时间
     void addCar(int startPointId, int endPointId);
     
-    // 模拟时间前进
+    // 模拟时间前进，结束后重算地图中缓存的道路通行时间
     void simulateTimeStep(double timeStep);
     
     // 获取当前时间
@@ -44,8 +45,12 @@ public:
     // 获取所有车辆的当前位置（使用智能指针）
     std::vector<std::pair<int, std::shared_ptr<Point>>> getAllCarPositions() const;
     
-    // 新增：设置阈值
+    // 新增：设置阈值（会重算所有道路的通行时间）
     void setThreshold(double newThreshold);
+    
+    // 当前使用的常数c和阈值
+    double getC() const;
+    double getThreshold() const;
 };
 
 #endif // TRAFFIC_SIMULATOR_H
\ No newline at end of file
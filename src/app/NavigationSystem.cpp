@@ -1,4 +1,6 @@
 #include "NavigationSystem.h"
+#include "../core/MapFile.h"
+#include <algorithm>
 #include <iostream>
 #include <thread> // 添加线程头文件
 #include <unordered_set> // 需要包含这个头文件
@@ -7,8 +9,9 @@
 const double DEFAULT_C = 0.1;           // 道路通行时间计算中的常数c
 const double DEFAULT_THRESHOLD = 0.7;    // 拥堵判断阈值
 const double DEFAULT_MAX_ROAD_DISTANCE = 100.0; // 连接点的最大距离
+const char* const DEFAULT_MAP_CACHE_FILE = "navigation_map.bin"; // 地图缓存文件（含KD树和收缩层次）
 
-NavigationSystem::NavigationSystem(int numPoints, int viewportWidth, int viewportHeight) {
+NavigationSystem::NavigationSystem(int numPoints, int viewportWidth, int viewportHeight) : numPoints(numPoints) {
     // 初始化地图生成器
     mapGenerator = new MapGenerator(numPoints, 1000.0, 1000.0, DEFAULT_MAX_ROAD_DISTANCE);
 
@@ -38,20 +41,60 @@ void NavigationSystem::initialize() {
     std::cout << "启动导航系统后台初始化线程..." << std::endl;
 
     std::thread initWorkerThread([this]() {
-        std::cout << "[后台线程] 开始生成地图..." << std::endl;
-        this->map = this->mapGenerator->generateMap(); // mapGenerator 应返回一个新创建并填充的 Map 对象
+        // 优先从缓存文件加载地图，生成参数（点数、地图尺寸、道路距离、生成算法版本）不符时重新生成
+        const uint64_t parameterKey = this->mapGenerator->getParameterKey();
+        std::cout << "[后台线程] 尝试加载地图缓存 " << DEFAULT_MAP_CACHE_FILE << "..." << std::endl;
+        uint64_t cachedKey = 0;
+        this->map = MapFile::load(DEFAULT_MAP_CACHE_FILE, &cachedKey);
+        if (this->map && (cachedKey != parameterKey ||
+                          static_cast<int>(this->map->pointsView().size()) != this->numPoints)) {
+            std::cout << "[后台线程] 缓存地图的生成参数不符，重新生成。" << std::endl;
+            delete this->map;
+            this->map = nullptr;
+        }
+
+        // 缓存中缺少的索引在下面补建，补建后重新写回缓存
+        bool cacheOutdated = false;
+        if (this->map) {
+            std::cout << "[后台线程] 地图缓存加载完毕。" << std::endl;
+            if (!this->map->isKDTreeBuilt()) {
+                std::cout << "[后台线程] 缓存中没有KD树，开始构建KD树..." << std::endl;
+                this->map->rebuildKDTree();
+                cacheOutdated = true;
+            }
+        } else {
+            std::cout << "[后台线程] 开始生成地图..." << std::endl;
+            this->map = this->mapGenerator->generateMap(); // mapGenerator 应返回一个新创建并填充的 Map 对象
+
+            if (!this->map) {
+                std::cerr << "[后台线程] 错误：地图生成失败！" << std::endl;
+                // initialized 将保持 false，系统将不会标记为可用
+                return;
+            }
 
-        if (!this->map) {
-            std::cerr << "[后台线程] 错误：地图生成失败！" << std::endl;
-            // initialized 将保持 false，系统将不会标记为可用
-            return;
+            std::cout << "[后台线程] 地图生成完毕。开始构建KD树..." << std::endl;
+            this->map->rebuildKDTree();
+            cacheOutdated = true;
         }
 
-        std::cout << "[后台线程] 地图生成完毕。开始构建KD树..." << std::endl;
-        this->map->rebuildKDTree();
+        // 收缩层次随地图一起缓存：只有新生成的地图才需要收缩（大地图上要十几秒），之后的启动直接加载
+        if (!this->map->isContractionHierarchyBuilt()) {
+            std::cout << "[后台线程] 开始构建收缩层次..." << std::endl;
+            this->map->rebuildContractionHierarchy();
+            cacheOutdated = true;
+        }
+
+        if (cacheOutdated && !MapFile::save(*this->map, DEFAULT_MAP_CACHE_FILE, true, parameterKey)) {
+            std::cerr << "[后台线程] 警告：地图缓存写入失败。" << std::endl;
+        }
 
-        std::cout << "[后台线程] KD树构建完毕。开始创建路径查找器..." << std::endl;
+        std::cout << "[后台线程] 开始构建道路吸附索引..." << std::endl;
+        this->map->rebuildRoadSnapIndex();
+
+        // 可定制收缩层次不在这里构建：第一次最快路径查询在定制时一并构建
+        std::cout << "[后台线程] 道路吸附索引构建完毕。开始创建路径查找器..." << std::endl;
         this->pathFinder = new PathFinder(this->map);
+        this->pathFinder->setSearchMode(SearchMode::ContractionHierarchy);
 
         std::cout << "[后台线程] 路径查找器创建完毕。开始创建交通模拟器..." << std::endl;
         this->trafficSimulator = new TrafficSimulator(this->map, DEFAULT_C, DEFAULT_THRESHOLD);
@@ -80,52 +123,36 @@ bool NavigationSystem::isInitialized() const {
     return initialized;
 }
 
-std::pair<std::vector<Point*>, std::vector<Road*>> NavigationSystem::getPointsAndRoadsNear(double x, double y, int count) {
-    if (!initialized || !map) { // 确保检查 initialized 和 map
-        if (!initialized) {
-            std::cout << "getPointsAndRoadsNear: 系统尚未初始化。" << std::endl;
-        }
-        if (!map) {
-            std::cout << "getPointsAndRoadsNear: 地图对象为空。" << std::endl;
-        }
+std::pair<std::vector<Point*>, std::vector<Road*>> NavigationSystem::getPointsAndRoadsInRect(double minX, double minY, double maxX, double maxY) {
+    if (!initialized || !map) {
+        std::cout << "getPointsAndRoadsInRect: 系统尚未初始化。" << std::endl;
         return {{}, {}};
     }
-    std::vector<Point*> nearPoints = map->getNearestPoints(x, y, count);
-    std::vector<Road*> relevantRoads;
-    std::unordered_set<int> roadIds; // 用于避免重复添加道路
+    std::vector<Point*> pointsInRect = map->getPointsInRect(minX, minY, maxX, maxY);
+    return {pointsInRect, collectRoadsTouching(pointsInRect)};
+}
 
-    if (nearPoints.empty()) {
-        // std::cout << "getPointsAndRoadsNear: map->getNearestPoints 未找到点。" << std::endl; // 可选的调试输出
-        return {nearPoints, relevantRoads};
+std::pair<std::vector<Point*>, std::vector<Road*>> NavigationSystem::getPointsAndRoadsWithinRadius(double x, double y, double radius) {
+    if (!initialized || !map) {
+        std::cout << "getPointsAndRoadsWithinRadius: 系统尚未初始化。" << std::endl;
+        return {{}, {}};
     }
+    std::vector<Point*> pointsInRange = map->getPointsWithinRadius(x, y, radius);
+    return {pointsInRange, collectRoadsTouching(pointsInRange)};
+}
 
-    for (Point* p1 : nearPoints) {
-        if (!p1) continue;
-        std::vector<Road*> roadsFromP1 = map->getRoadsFromPoint(p1->getId());
-        for (Road* road : roadsFromP1) {
-            if (!road || roadIds.count(road->getId())) {
-                continue; // 道路为空或已添加
-            }
-
-            Point* p2 = (road->getStartPoint()->getId() == p1->getId()) ? road->getEndPoint() : road->getStartPoint();
-            if (!p2) continue;
-
-            // 检查 p2 是否也在 nearPoints 列表中
-            bool p2_is_near = false;
-            for (Point* np : nearPoints) {
-                if (np && np->getId() == p2->getId()) {
-                    p2_is_near = true;
-                    break;
-                }
-            }
+std::vector<Road*> NavigationSystem::collectRoadsTouching(const std::vector<Point*>& points) const {
+    std::vector<Road*> relevantRoads;
+    std::unordered_set<int> roadIds; // 用于避免重复添加道路
 
-            if (p2_is_near) {
+    for (Point* p : points) {
+        for (Road* road : map->roadsFromPointView(p->getId())) {
+            if (roadIds.insert(road->getId()).second) {
                 relevantRoads.push_back(road);
-                roadIds.insert(road->getId());
             }
         }
     }
-    return {nearPoints, relevantRoads};
+    return relevantRoads;
 }
 
 // 新增：获取地图中的所有点和道路
@@ -166,18 +193,71 @@ std::pair<std::vector<Point*>, std::vector<Road*>> NavigationSystem::getShortest
         return {{}, {}};
     }
 
-    std::vector<Point*> pathPoints = pathFinder->findShortestPath(startPointId, endPointId);
+    // 道路由搜索一并给出，与实际松弛的道路一致
+    std::vector<Road*> pathRoads;
+    std::vector<Point*> pathPoints = pathFinder->findShortestPath(startPointId, endPointId, nullptr, &pathRoads);
 
     if (pathPoints.size() < 2) { // 路径至少需要两个点
         // std::cout << "无法找到从点 " << startPointId << " 到点 " << endPointId << " 的路径！" << std::endl;
         return {{}, {}}; // 返回空数据
     }
 
-    std::vector<Road*> pathRoads = pathFinder->getRoadsInPath(pathPoints);
-
     return {pathPoints, pathRoads};
 }
 
+LocationRoute NavigationSystem::makeLocationRoute(const RoadSnap& from, const RoadSnap& to, const SnappedRoute& route) const {
+    LocationRoute result;
+    if (!route.found) {
+        return result;
+    }
+    result.found = true;
+    result.fromX = from.x;
+    result.fromY = from.y;
+    result.toX = to.x;
+    result.toY = to.y;
+    result.points = route.points;
+    result.cost = route.cost;
+
+    // 道路依次为：起点所在道路、途经路口之间的道路、终点所在道路
+    result.roads.push_back(from.road);
+    for (Road* road : route.roads) {
+        result.roads.push_back(road);
+    }
+    if (to.road != result.roads.back()) {
+        result.roads.push_back(to.road);
+    }
+    return result;
+}
+
+LocationRoute NavigationSystem::getShortestPathBetweenLocations(double fromX, double fromY, double toX, double toY) {
+    if (!initialized || !pathFinder || !map) {
+        std::cout << "getShortestPathBetweenLocations: 系统、路径查找器或地图未初始化。" << std::endl;
+        return LocationRoute();
+    }
+
+    // 起终点吸附到最近的道路上，路线从道路中途开始和结束
+    RoadSnap from = map->snapToRoad(fromX, fromY);
+    RoadSnap to = map->snapToRoad(toX, toY);
+    if (!from.road || !to.road) {
+        return LocationRoute();
+    }
+    return makeLocationRoute(from, to, pathFinder->findShortestPath(from, to));
+}
+
+LocationRoute NavigationSystem::getFastestPathBetweenLocations(double fromX, double fromY, double toX, double toY) {
+    if (!initialized || !pathFinder || !map || !trafficSimulator) {
+        std::cout << "getFastestPathBetweenLocations: 系统、路径查找器、地图或交通模拟器未初始化。" << std::endl;
+        return LocationRoute();
+    }
+
+    RoadSnap from = map->snapToRoad(fromX, fromY);
+    RoadSnap to = map->snapToRoad(toX, toY);
+    if (!from.road || !to.road) {
+        return LocationRoute();
+    }
+    return makeLocationRoute(from, to, pathFinder->findFastestPath(from, to, DEFAULT_C, currentTrafficThreshold()));
+}
+
 // 新增：实现获取最快路径数据的方法
 std::pair<std::vector<Point*>, std::vector<Road*>> NavigationSystem::getFastestPath(int startPointId, int endPointId) {
     if (!initialized || !pathFinder || !map || !trafficSimulator) {
@@ -195,17 +275,16 @@ std::pair<std::vector<Point*>, std::vector<Road*>> NavigationSystem::getFastestP
     }
 
     // 使用 PathFinder 计算最快路径的点
-    // 注意：这里的 DEFAULT_C 和 DEFAULT_THRESHOLD 是在 NavigationSystem.cpp 顶部定义的常量
-    std::vector<Point*> pathPoints = pathFinder->findFastestPath(startPointId, endPointId, DEFAULT_C, DEFAULT_THRESHOLD);
+    // 注意：这里的 DEFAULT_C 是在 NavigationSystem.cpp 顶部定义的常量，阈值跟随交通模拟器
+    std::vector<Road*> pathRoads;
+    std::vector<Point*> pathPoints = pathFinder->findFastestPath(startPointId, endPointId, DEFAULT_C, currentTrafficThreshold(),
+                                                                 nullptr, &pathRoads);
 
     if (pathPoints.size() < 2) { // 路径至少需要两个点
         // std::cout << "无法找到从点 " << startPointId << " 到点 " << endPointId << " 的最快路径！" << std::endl;
         return {{}, {}}; // 返回空数据
     }
 
-    // 获取路径上的道路
-    std::vector<Road*> pathRoads = pathFinder->getRoadsInPath(pathPoints);
-
     return {pathPoints, pathRoads};
 }
 
@@ -215,8 +294,8 @@ void NavigationSystem::showMapAroundLocation(double x, double y) {
         std::cout << "System not initialized." << std::endl;
         return;
     }
-    // 获取附近的点
-    auto data = getPointsAndRoadsNear(x, y, 100); // 使用新方法
+    // 获取半径 NEARBY_RADIUS 内的点
+    auto data = getPointsAndRoadsWithinRadius(x, y, NEARBY_RADIUS);
 
     // (可选) 如果你还想在控制台输出信息：
     std::cout << "查询坐标 (" << x << ", " << y << ") 附近的点和路:" << std::endl;
@@ -241,7 +320,8 @@ void NavigationSystem::showShortestPath(int startPointId, int endPointId) {
     }
 
     // 计算最短路径
-    std::vector<Point*> path = pathFinder->findShortestPath(startPointId, endPointId);
+    std::vector<Road*> roads;
+    std::vector<Point*> path = pathFinder->findShortestPath(startPointId, endPointId, nullptr, &roads);
 
     // 如果找不到路径
     if (path.size() < 2) {
@@ -250,7 +330,7 @@ void NavigationSystem::showShortestPath(int startPointId, int endPointId) {
     }
 
     // 计算路径长度
-    double pathLength = pathFinder->calculatePathLength(path);
+    double pathLength = pathFinder->calculatePathLength(roads);
 
     // 显示路径信息
     std::cout << "从点 " << startPointId << " 到点 " << endPointId
@@ -268,7 +348,9 @@ void NavigationSystem::showFastestPath(int startPointId, int endPointId) {
     }
 
     // 计算最快路径（考虑路况）
-    std::vector<Point*> path = pathFinder->findFastestPath(startPointId, endPointId, DEFAULT_C, DEFAULT_THRESHOLD);
+    std::vector<Road*> roads;
+    std::vector<Point*> path = pathFinder->findFastestPath(startPointId, endPointId, DEFAULT_C, currentTrafficThreshold(),
+                                                           nullptr, &roads);
 
     // 如果找不到路径
     if (path.size() < 2) {
@@ -277,8 +359,8 @@ void NavigationSystem::showFastestPath(int startPointId, int endPointId) {
     }
 
     // 计算路径长度和行驶时间
-    double pathLength = pathFinder->calculatePathLength(path);
-    double travelTime = pathFinder->calculatePathTravelTime(path, DEFAULT_C, DEFAULT_THRESHOLD);
+    double pathLength = pathFinder->calculatePathLength(roads);
+    double travelTime = pathFinder->calculatePathTravelTime(roads, DEFAULT_C, currentTrafficThreshold());
 
     // 显示路径信息
     std::cout << "从点 " << startPointId << " 到点 " << endPointId
@@ -343,5 +425,16 @@ double NavigationSystem::getPathTravelTime(const std::vector<Point*>& pathPoints
     if (!pathFinder || pathPoints.empty()) {
         return 0.0;
     }
-    return pathFinder->calculatePathTravelTime(pathPoints, DEFAULT_C, DEFAULT_THRESHOLD);
+    return pathFinder->calculatePathTravelTime(pathPoints, DEFAULT_C, currentTrafficThreshold());
+}
+
+double NavigationSystem::getPathTravelTime(const std::vector<Road*>& pathRoads) const {
+    if (!pathFinder || pathRoads.empty()) {
+        return 0.0;
+    }
+    return pathFinder->calculatePathTravelTime(pathRoads, DEFAULT_C, currentTrafficThreshold());
+}
+
+double NavigationSystem::currentTrafficThreshold() const {
+    return trafficSimulator ? trafficSimulator->getThreshold() : DEFAULT_THRESHOLD;
 }
@@ -11,6 +11,18 @@
 #include "core/Point.h"
 #include "core/Road.h"
 
+// 两个任意坐标之间的路线：起终点吸附到最近的道路上，路线可以从道路中途开始和结束
+struct LocationRoute {
+    bool found = false;
+    double fromX = 0.0;          // 吸附后的起点位置
+    double fromY = 0.0;
+    double toX = 0.0;            // 吸附后的终点位置
+    double toY = 0.0;
+    std::vector<Point*> points;  // 途经的路口
+    std::vector<Road*> roads;    // 依次经过的道路，首尾为起终点所在的道路
+    double cost = 0.0;           // 总长度或总行驶时间，包含首尾道路上的部分
+};
+
 class NavigationSystem {
 private:
     Map* map;
@@ -19,16 +31,32 @@ private:
     TrafficSimulator* trafficSimulator;
     MapRenderer* mapRenderer;
     bool initialized = false; // 添加一个初始化状态标志
+    int numPoints; // 请求的地图点数，用于校验缓存的地图文件
+    
+    // 路径规划使用与交通模拟器相同的阈值，这样可以直接读取地图中缓存的通行时间
+    double currentTrafficThreshold() const;
+    
+    // 收集与给定点相连的道路（去重）
+    std::vector<Road*> collectRoadsTouching(const std::vector<Point*>& points) const;
+    
+    // 把吸附后的起终点和 PathFinder 的结果整理成 LocationRoute
+    LocationRoute makeLocationRoute(const RoadSnap& from, const RoadSnap& to, const SnappedRoute& route) const;
 public:
+    // "显示附近"类查询使用的半径（地图坐标单位），按距离而不是固定点数取附近的点
+    static constexpr double NEARBY_RADIUS = 60.0;
+    
     NavigationSystem(int numPoints, int viewportWidth, int viewportHeight);
     ~NavigationSystem();
     
     // 初始化系统
     void initialize(); // 确保有这个声明
     bool isInitialized() const; // 添加这个方法
-
-    // 新方法：获取指定坐标附近的点和相关联的边
-    std::pair<std::vector<Point*>, std::vector<Road*>> getPointsAndRoadsNear(double x, double y, int count);
+    
+    // 获取矩形视口内的点，以及至少有一个端点在视口内的道路
+    std::pair<std::vector<Point*>, std::vector<Road*>> getPointsAndRoadsInRect(double minX, double minY, double maxX, double maxY);
+    
+    // 获取以 (x, y) 为圆心、radius 为半径的范围内的点，以及至少有一个端点在范围内的道路
+    std::pair<std::vector<Point*>, std::vector<Road*>> getPointsAndRoadsWithinRadius(double x, double y, double radius);
     
     // 新方法：获取地图中的所有点和道路
     std::pair<std::vector<Point*>, std::vector<Road*>> getAllPointsAndRoads();
@@ -41,16 +69,21 @@ public:
     
     // 新增：获取两点间最快路径的点和边 (供UI调用)
     std::pair<std::vector<Point*>, std::vector<Road*>> getFastestPath(int startPointId, int endPointId);
-
+    
+    // 任意两个坐标之间的最短/最快路径：起终点先吸附到最近的道路上，路线可以从道路中途开始和结束。
+    // 找不到道路或不可达时 found 为 false
+    LocationRoute getShortestPathBetweenLocations(double fromX, double fromY, double toX, double toY);
+    LocationRoute getFastestPathBetweenLocations(double fromX, double fromY, double toX, double toY);
+    
     // 显示指定位置附近的地图
     void showMapAroundLocation(double x, double y);
     
     // 新增：显示两点间的最短路径 (修复报错)
     void showShortestPath(int startPointId, int endPointId);
-
+    
     // 新增：显示两点间的最快路径
     void showFastestPath(int startPointId, int endPointId);
-
+    
     // 计算两点间的最短路径
     void calculateShortestPath(int startPointId, int endPointId);
     
@@ -62,7 +95,7 @@ public:
     
     // 模拟交通流量
     void simulateTraffic(double timeStep);
-
+    
     // 新增：地图缩放功能声明
     void zoomMap(double factor);
     
@@ -76,8 +109,9 @@ public:
     // 新增：设置交通拥堵阈值
     void setTrafficThreshold(double threshold);
     
-    // 计算给定路径的行驶时间
+    // 计算给定路径的行驶时间；按道路计算时与 getShortestPath/getFastestPath 返回的道路一致
     double getPathTravelTime(const std::vector<Point*>& pathPoints) const;
+    double getPathTravelTime(const std::vector<Road*>& pathRoads) const;
 };
 
 #endif // NAVIGATION_SYSTEM_H
\ No newline at end of file
@@ -0,0 +1,186 @@
+#include "GeometryKernels.h"
+#include <cmath>
+
+#if defined(__x86_64__) || defined(_M_X64)
+#define GEOMETRY_KERNELS_X86 1
+#include <immintrin.h>
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+#endif
+
+// GCC/Clang 按函数开启AVX2，不需要给整个工程加 -mavx2；MSVC 可以直接使用内建函数
+#if defined(GEOMETRY_KERNELS_X86) && (defined(__GNUC__) || defined(__clang__))
+#define AVX2_TARGET __attribute__((target("avx2")))
+#else
+#define AVX2_TARGET
+#endif
+
+namespace {
+
+void squaredDistancesScalar(const double* xs, const double* ys, size_t begin, size_t n,
+                            double qx, double qy, double* out) {
+    for (size_t i = begin; i < n; i++) {
+        double dx = xs[i] - qx;
+        double dy = ys[i] - qy;
+        out[i] = dx * dx + dy * dy;
+    }
+}
+
+size_t filterInBoxScalar(const double* xs, const double* ys, size_t begin, size_t n,
+                         double minX, double minY, double maxX, double maxY,
+                         int* outIndices, size_t count) {
+    for (size_t i = begin; i < n; i++) {
+        if (xs[i] >= minX && xs[i] <= maxX && ys[i] >= minY && ys[i] <= maxY) {
+            outIndices[count++] = static_cast<int>(i);
+        }
+    }
+    return count;
+}
+
+double congestedTravelTime(double base, double ratio, double threshold) {
+    return base * (1.0 + std::exp(ratio - threshold));
+}
+
+void travelTimesScalar(const double* lengths, const double* ratios, size_t begin, size_t n,
+                       double c, double threshold, double* out) {
+    for (size_t i = begin; i < n; i++) {
+        double base = c * lengths[i];
+        out[i] = (ratios[i] > threshold) ? congestedTravelTime(base, ratios[i], threshold) : base;
+    }
+}
+
+#ifdef GEOMETRY_KERNELS_X86
+
+bool detectAVX2() {
+#ifdef _MSC_VER
+    int info[4];
+    __cpuid(info, 0);
+    if (info[0] < 7) return false;
+    __cpuid(info, 1);
+    bool osxsave = (info[2] & (1 << 27)) != 0;
+    bool avx = (info[2] & (1 << 28)) != 0;
+    if (!osxsave || !avx) return false;
+    // 操作系统需要保存YMM寄存器状态
+    if ((_xgetbv(0) & 0x6) != 0x6) return false;
+    __cpuidex(info, 7, 0);
+    return (info[1] & (1 << 5)) != 0;
+#else
+    __builtin_cpu_init();
+    return __builtin_cpu_supports("avx2");
+#endif
+}
+
+AVX2_TARGET
+void squaredDistancesAVX2(const double* xs, const double* ys, size_t n,
+                          double qx, double qy, double* out) {
+    const __m256d vqx = _mm256_set1_pd(qx);
+    const __m256d vqy = _mm256_set1_pd(qy);
+    size_t i = 0;
+    for (; i + 4 <= n; i += 4) {
+        __m256d dx = _mm256_sub_pd(_mm256_loadu_pd(xs + i), vqx);
+        __m256d dy = _mm256_sub_pd(_mm256_loadu_pd(ys + i), vqy);
+        _mm256_storeu_pd(out + i, _mm256_add_pd(_mm256_mul_pd(dx, dx), _mm256_mul_pd(dy, dy)));
+    }
+    squaredDistancesScalar(xs, ys, i, n, qx, qy, out);
+}
+
+AVX2_TARGET
+size_t filterInBoxAVX2(const double* xs, const double* ys, size_t n,
+                       double minX, double minY, double maxX, double maxY,
+                       int* outIndices) {
+    const __m256d vminX = _mm256_set1_pd(minX);
+    const __m256d vminY = _mm256_set1_pd(minY);
+    const __m256d vmaxX = _mm256_set1_pd(maxX);
+    const __m256d vmaxY = _mm256_set1_pd(maxY);
+    size_t count = 0;
+    size_t i = 0;
+    for (; i + 4 <= n; i += 4) {
+        __m256d x = _mm256_loadu_pd(xs + i);
+        __m256d y = _mm256_loadu_pd(ys + i);
+        __m256d inside = _mm256_and_pd(
+            _mm256_and_pd(_mm256_cmp_pd(x, vminX, _CMP_GE_OQ), _mm256_cmp_pd(x, vmaxX, _CMP_LE_OQ)),
+            _mm256_and_pd(_mm256_cmp_pd(y, vminY, _CMP_GE_OQ), _mm256_cmp_pd(y, vmaxY, _CMP_LE_OQ)));
+        int mask = _mm256_movemask_pd(inside);
+        // 按位写出命中的下标，保持升序
+        for (int lane = 0; lane < 4; lane++) {
+            if (mask & (1 << lane)) {
+                outIndices[count++] = static_cast<int>(i) + lane;
+            }
+        }
+    }
+    return filterInBoxScalar(xs, ys, i, n, minX, minY, maxX, maxY, outIndices, count);
+}
+
+AVX2_TARGET
+void travelTimesAVX2(const double* lengths, const double* ratios, size_t n,
+                     double c, double threshold, double* out) {
+    const __m256d vc = _mm256_set1_pd(c);
+    const __m256d vthreshold = _mm256_set1_pd(threshold);
+    size_t i = 0;
+    for (; i + 4 <= n; i += 4) {
+        __m256d base = _mm256_mul_pd(vc, _mm256_loadu_pd(lengths + i));
+        _mm256_storeu_pd(out + i, base);
+        // 大多数道路不拥堵，只对超过阈值的通道补算指数
+        int mask = _mm256_movemask_pd(_mm256_cmp_pd(_mm256_loadu_pd(ratios + i), vthreshold, _CMP_GT_OQ));
+        if (mask) {
+            for (int lane = 0; lane < 4; lane++) {
+                if (mask & (1 << lane)) {
+                    out[i + lane] = congestedTravelTime(out[i + lane], ratios[i + lane], threshold);
+                }
+            }
+        }
+    }
+    travelTimesScalar(lengths, ratios, i, n, c, threshold, out);
+}
+
+const bool hasAVX2 = detectAVX2();
+
+#endif // GEOMETRY_KERNELS_X86
+
+} // namespace
+
+namespace GeometryKernels {
+
+bool usingAVX2() {
+#ifdef GEOMETRY_KERNELS_X86
+    return hasAVX2;
+#else
+    return false;
+#endif
+}
+
+void squaredDistances(const double* xs, const double* ys, size_t n,
+                      double qx, double qy, double* out) {
+#ifdef GEOMETRY_KERNELS_X86
+    if (hasAVX2) {
+        squaredDistancesAVX2(xs, ys, n, qx, qy, out);
+        return;
+    }
+#endif
+    squaredDistancesScalar(xs, ys, 0, n, qx, qy, out);
+}
+
+size_t filterInBox(const double* xs, const double* ys, size_t n,
+                   double minX, double minY, double maxX, double maxY,
+                   int* outIndices) {
+#ifdef GEOMETRY_KERNELS_X86
+    if (hasAVX2) {
+        return filterInBoxAVX2(xs, ys, n, minX, minY, maxX, maxY, outIndices);
+    }
+#endif
+    return filterInBoxScalar(xs, ys, 0, n, minX, minY, maxX, maxY, outIndices, 0);
+}
+
+void travelTimes(const double* lengths, const double* ratios, size_t n,
+                 double c, double threshold, double* out) {
+#ifdef GEOMETRY_KERNELS_X86
+    if (hasAVX2) {
+        travelTimesAVX2(lengths, ratios, n, c, threshold, out);
+        return;
+    }
+#endif
+    travelTimesScalar(lengths, ratios, 0, n, c, threshold, out);
+}
+
+} // namespace GeometryKernels
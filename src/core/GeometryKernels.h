@@ -0,0 +1,31 @@
+#ifndef GEOMETRY_KERNELS_H
+#define GEOMETRY_KERNELS_H
+
+#include <cstddef>
+
+// 面向结构数组(SoA)的批量计算：几何距离、包围盒过滤和道路通行时间
+// x86-64 上运行时检测 AVX2，不支持时（或其他架构）使用标量实现，结果一致
+namespace GeometryKernels {
+
+// 当前CPU是否走AVX2路径
+bool usingAVX2();
+
+// 一对多平方距离：out[i] = (xs[i] - qx)^2 + (ys[i] - qy)^2
+void squaredDistances(const double* xs, const double* ys, size_t n,
+                      double qx, double qy, double* out);
+
+// 包围盒过滤：把落在 [minX, maxX] x [minY, maxY]（含边界）内的元素下标
+// 按升序写入 outIndices（容量至少为n），返回写入的数量
+size_t filterInBox(const double* xs, const double* ys, size_t n,
+                   double minX, double minY, double maxX, double maxY,
+                   int* outIndices);
+
+// 道路通行时间：out[i] = c * lengths[i] * factor，
+// ratios[i]（车流量/容量）超过 threshold 时 factor = 1 + exp(ratios[i] - threshold)，否则为1。
+// 与 Road::getTravelTime 逐位一致；exp 只对超过阈值的道路计算
+void travelTimes(const double* lengths, const double* ratios, size_t n,
+                 double c, double threshold, double* out);
+
+} // namespace GeometryKernels
+
+#endif // GEOMETRY_KERNELS_H
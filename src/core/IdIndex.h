@@ -0,0 +1,58 @@
+#ifndef ID_INDEX_H
+#define ID_INDEX_H
+
+#include <cstddef>
+#include <vector>
+#include <unordered_map>
+
+// ID到数组下标的映射表
+// 稠密ID（0..N附近）直接存放在数组中，O(1)查找；
+// 负数或远超当前规模的稀疏ID退化到哈希表
+class IdIndex {
+private:
+    std::vector<int> dense;                 // dense[id] = 下标，-1表示不存在
+    std::unordered_map<int, int> sparse;    // 稀疏ID的后备哈希表
+
+    // 超过这个范围的ID视为稀疏ID，避免一个很大的ID撑爆数组
+    bool fitsDense(int id) const {
+        return id >= 0 && static_cast<size_t>(id) < dense.size() * 2 + 1024;
+    }
+
+public:
+    void reserve(size_t count) {
+        dense.reserve(count);
+    }
+
+    void insert(int id, int index) {
+        if (fitsDense(id)) {
+            if (static_cast<size_t>(id) >= dense.size()) {
+                dense.resize(id + 1, -1);
+            }
+            dense[id] = index;
+        } else {
+            sparse[id] = index;
+        }
+    }
+
+    // 返回ID对应的下标，不存在时返回-1
+    int find(int id) const {
+        if (id >= 0 && static_cast<size_t>(id) < dense.size()) {
+            int index = dense[id];
+            if (index >= 0 || sparse.empty()) {
+                return index;
+            }
+        }
+        if (sparse.empty()) {
+            return -1;
+        }
+        auto it = sparse.find(id);
+        return (it != sparse.end()) ? it->second : -1;
+    }
+
+    void clear() {
+        dense.clear();
+        sparse.clear();
+    }
+};
+
+#endif // ID_INDEX_H
@@ -1,34 +1,93 @@
 #include "Map.h"
+#include "GeometryKernels.h"
+#include "SpaceFillingCurve.h"
 #include <algorithm>
 #include <queue>
 #include <unordered_set>
 
 
-Map::Map() {
+Map::Map() : travelTimeVersion(0), travelTimeC(0.0), travelTimeThreshold(0.0), travelTimeMinFactor(1.0),
+             customizedTravelTimeVersion(0), topologyFrozen(false) {
     kdTree = new KDTree();
+    roadSnapIndex = new RoadSnapIndex();
+    contractionHierarchy = new ContractionHierarchy();
+    customizableHierarchy = new CustomizableHierarchy();
 }
 
 Map::~Map() {
-    // 释放所有点和道路的内存
+    // 竞技场中的对象随竞技场整块释放，这里只释放通过 addPoint/addRoad 交给地图的堆对象
     for (auto point : points) {
-        delete point;
+        if (!pointArena.contains(point)) {
+            delete point;
+        }
     }
     
     for (auto road : roads) {
-        delete road;
+        if (!roadArena.contains(road)) {
+            delete road;
+        }
     }
     
     delete kdTree;
+    delete roadSnapIndex;
+    delete contractionHierarchy;
+    delete customizableHierarchy;
+}
+
+Point* Map::createPoint(double x, double y) {
+    return createPoint(getNextPointId(), x, y);
+}
+
+Road* Map::createRoad(Point* start, Point* end) {
+    return createRoad(getNextRoadId(), start, end);
+}
+
+Point* Map::createPoint(int id, double x, double y) {
+    Point* point = pointArena.create(id, x, y);
+    addPoint(point);
+    return point;
+}
+
+Road* Map::createRoad(int id, Point* start, Point* end) {
+    Road* road = roadArena.create(id, start, end);
+    addRoad(road);
+    return road;
 }
 
 void Map::addPoint(Point* point) {
+    pointIndexById.insert(point->getId(), static_cast<int>(points.size()));
     points.push_back(point);
+    pointXs.push_back(point->getX());
+    pointYs.push_back(point->getY());
     // 初始化该点的邻接表
     adjacencyList[point->getId()] = std::vector<Road*>();
+    neighborIndexList[point->getId()] = std::vector<int>();
+    // 拓扑已改变，CSR不再有效
+    topologyFrozen = false;
+    
+    // KD树已构建时增量插入，保持索引与地图一致；尚未构建时留给之后的批量构建
+    if (!kdTree->empty()) {
+        kdTree->insert(point);
+    }
+    
+    // 收缩层次的点数已不一致
+    contractionHierarchy->clear();
+    customizableHierarchy->clear();
+    customizedTravelTimeVersion.store(0, std::memory_order_release);
 }
 
 void Map::addRoad(Road* road) {
+    roadIndexById.insert(road->getId(), static_cast<int>(roads.size()));
     roads.push_back(road);
+    roadLengths.push_back(road->getLength());
+    
+    // 把道路的交通状态迁移到连续数组中
+    if (roadTraffic.append(road->getCapacity(), road->getCurrentCars())) {
+        rebindRoadTraffic();
+    } else {
+        road->bindTraffic(&roadTraffic[roads.size() - 1]);
+    }
+    topologyFrozen = false;
     
     // 更新邻接表
     int startId = road->getStartPoint()->getId();
@@ -37,24 +96,36 @@ void Map::addRoad(Road* road) {
     adjacencyList[startId].push_back(road);
     // 假设道路是双向的
     adjacencyList[endId].push_back(road);
+    
+    int startIndex = indexOfPoint(startId);
+    int endIndex = indexOfPoint(endId);
+    if (startIndex >= 0 && endIndex >= 0) {
+        neighborIndexList[startId].push_back(endIndex);
+        neighborIndexList[endId].push_back(startIndex);
+    }
+    
+    // 维护边索引，重复道路保留最先加入的一条
+    edgeIndex.emplace(edgeKey(startId, endId), road);
+    
+    // 吸附索引已构建时增量加入
+    if (!roadSnapIndex->empty()) {
+        roadSnapIndex->insert(road);
+    }
+    
+    // 新道路可能缩短已有的最短路径，收缩层次失效
+    contractionHierarchy->clear();
+    customizableHierarchy->clear();
+    customizedTravelTimeVersion.store(0, std::memory_order_release);
 }
 
 Point* Map::getPointById(int id) const {
-    for (auto point : points) {
-        if (point->getId() == id) {
-            return point;
-        }
-    }
-    return nullptr;
+    int index = pointIndexById.find(id);
+    return (index >= 0) ? points[index] : nullptr;
 }
 
 Road* Map::getRoadById(int id) const {
-    for (auto road : roads) {
-        if (road->getId() == id) {
-            return road;
-        }
-    }
-    return nullptr;
+    int index = roadIndexById.find(id);
+    return (index >= 0) ? roads[index] : nullptr;
 }
 
 std::vector<Point*> Map::getAllPoints() const {
@@ -65,27 +136,125 @@ std::vector<Road*> Map::getAllRoads() const {
     return roads;
 }
 
-std::vector<Road*> Map::getRoadsFromPoint(int pointId) const {
+void Map::rebindRoadTraffic() {
+    for (size_t i = 0; i < roads.size(); i++) {
+        roads[i]->bindTraffic(&roadTraffic[i]);
+    }
+}
+
+void Map::updateTravelTimes(double c, double threshold) {
+    size_t numRoads = roads.size();
+    roadLoadRatios.resize(numRoads);
+    roadTravelTimes.resize(numRoads);
+    
+    // 先把原子计数器读成连续的比值数组，再交给向量化内核
+    for (size_t i = 0; i < numRoads; i++) {
+        roadLoadRatios[i] = static_cast<double>(roadTraffic[i].getCurrentCars()) / roadTraffic[i].getCapacity();
+    }
+    GeometryKernels::travelTimes(roadLengths.data(), roadLoadRatios.data(), numRoads,
+                                 c, threshold, roadTravelTimes.data());
+    
+    // 记录最小拥堵因子，最快路径的A*启发式以它为下界
+    travelTimeMinFactor = std::numeric_limits<double>::infinity();
+    for (size_t i = 0; i < numRoads; i++) {
+        if (roadLengths[i] > 0.0 && c > 0.0) {
+            travelTimeMinFactor = std::min(travelTimeMinFactor, roadTravelTimes[i] / (c * roadLengths[i]));
+        }
+    }
+    if (!(travelTimeMinFactor < std::numeric_limits<double>::infinity())) {
+        travelTimeMinFactor = 1.0;
+    }
+    
+    travelTimeC = c;
+    travelTimeThreshold = threshold;
+    travelTimeVersion++;
+    
+    // 不在这里重新定制：模拟每一步都会调用本函数，而两次最快路径查询之间可能经过很多步，
+    // 定制推迟到下一次查询（见 prepareCustomizableHierarchy）
+}
+
+bool Map::prepareCustomizableHierarchy(double c, double threshold) {
+    if (!hasTravelTimes(c, threshold)) {
+        return false;
+    }
+    if (customizedTravelTimeVersion.load(std::memory_order_acquire) == travelTimeVersion) {
+        return true;
+    }
+    
+    std::lock_guard<std::mutex> lock(customizationMutex);
+    if (customizedTravelTimeVersion.load(std::memory_order_relaxed) != travelTimeVersion) {
+        // 第一次使用时才做嵌套剖分和符号收缩，启动时不必为可能用不到的最快路径付出这部分开销
+        if (customizableHierarchy->empty()) {
+            rebuildCustomizableHierarchy();
+            if (customizableHierarchy->empty()) {
+                return false;
+            }
+        }
+        // 通行时间的下标与构建时的道路一一对应
+        customizableHierarchy->customize(roadTravelTimes.data());
+        customizedTravelTimeVersion.store(travelTimeVersion, std::memory_order_release);
+    }
+    return true;
+}
+
+double Map::getRoadTravelTime(const Road* road, double c, double threshold) const {
+    if (hasTravelTimes(c, threshold)) {
+        int index = roadIndexById.find(road->getId());
+        if (index >= 0 && roads[index] == road) {
+            return roadTravelTimes[index];
+        }
+    }
+    return road->getTravelTime(c, threshold);
+}
+
+int Map::indexOfPoint(int pointId) const {
+    return pointIndexById.find(pointId);
+}
+
+IndexedSpan<Road*> Map::roadsFromPointView(int pointId) const {
+    if (topologyFrozen) {
+        int index = indexOfPoint(pointId);
+        if (index < 0) {
+            return IndexedSpan<Road*>();
+        }
+        int begin = csrOffsets[index];
+        return IndexedSpan<Road*>(roads.data(), csrEdges.data() + begin, csrOffsets[index + 1] - begin);
+    }
+    
     auto it = adjacencyList.find(pointId);
     if (it != adjacencyList.end()) {
-        return it->second;
+        return IndexedSpan<Road*>(it->second.data(), nullptr, it->second.size());
     }
-    return std::vector<Road*>();
+    return IndexedSpan<Road*>();
 }
 
-Road* Map::getRoadBetweenPoints(int startId, int endId) const {
-    auto roadsFromStart = getRoadsFromPoint(startId);
-    
-    for (auto road : roadsFromStart) {
-        Point* start = road->getStartPoint();
-        Point* end = road->getEndPoint();
-        
-        if ((start->getId() == startId && end->getId() == endId) ||
-            (start->getId() == endId && end->getId() == startId)) {
-            return road;
+IndexedSpan<Point*> Map::adjacentPointsView(int pointId) const {
+    if (topologyFrozen) {
+        int index = indexOfPoint(pointId);
+        if (index < 0) {
+            return IndexedSpan<Point*>();
         }
+        int begin = csrOffsets[index];
+        return IndexedSpan<Point*>(points.data(), csrNeighbors.data() + begin, csrOffsets[index + 1] - begin);
     }
     
+    auto it = neighborIndexList.find(pointId);
+    if (it != neighborIndexList.end()) {
+        return IndexedSpan<Point*>(points.data(), it->second.data(), it->second.size());
+    }
+    return IndexedSpan<Point*>();
+}
+
+std::vector<Road*> Map::getRoadsFromPoint(int pointId) const {
+    IndexedSpan<Road*> view = roadsFromPointView(pointId);
+    return std::vector<Road*>(view.begin(), view.end());
+}
+
+Road* Map::getRoadBetweenPoints(int startId, int endId) const {
+    auto it = edgeIndex.find(edgeKey(startId, endId));
+    if (it != edgeIndex.end()) {
+        return it->second;
+    }
     return nullptr;
 }
 
@@ -94,22 +263,52 @@ std::vector<Point*> Map::getNearestPoints(double x, double y, int count) const {
     return kdTree->findKNearest(x, y, count);
 }
 
-std::vector<Point*> Map::getAdjacentPoints(int pointId) const {
-    std::vector<Point*> adjacent;
-    auto roads = getRoadsFromPoint(pointId);
+int Map::getNearestPoints(double x, double y, int count, Point** results) const {
+    return kdTree->findKNearest(x, y, count, results);
+}
+
+void Map::getNearestPointsBatch(const double* xs, const double* ys, size_t numQueries, int count,
+                                std::vector<size_t>& offsets, std::vector<Point*>& results) const {
+    kdTree->findKNearestBatch(xs, ys, numQueries, count, offsets, results);
+}
+
+std::vector<Point*> Map::getPointsInRect(double minX, double minY, double maxX, double maxY) const {
+    if (kdTree->size() == points.size() && !points.empty()) {
+        return kdTree->findInRect(minX, minY, maxX, maxY);
+    }
     
-    for (auto road : roads) {
-        Point* start = road->getStartPoint();
-        Point* end = road->getEndPoint();
-        
-        if (start->getId() == pointId) {
-            adjacent.push_back(end);
-        } else {
-            adjacent.push_back(start);
-        }
+    // 在SoA坐标上做向量化的包围盒过滤
+    std::vector<int> hits(points.size());
+    size_t count = GeometryKernels::filterInBox(pointXs.data(), pointYs.data(), points.size(),
+                                                minX, minY, maxX, maxY, hits.data());
+    std::vector<Point*> result;
+    result.reserve(count);
+    for (size_t i = 0; i < count; i++) {
+        result.push_back(points[hits[i]]);
+    }
+    return result;
+}
+
+std::vector<Point*> Map::getPointsWithinRadius(double x, double y, double radius) const {
+    if (kdTree->size() == points.size()) {
+        return kdTree->findWithinRadius(x, y, radius);
     }
     
-    return adjacent;
+    // KD树尚未构建或已过期：先用包围盒过滤，再精确判断距离
+    std::vector<Point*> result;
+    for (Point* point : getPointsInRect(x - radius, y - radius, x + radius, y + radius)) {
+        double dx = point->getX() - x;
+        double dy = point->getY() - y;
+        if (dx * dx + dy * dy <= radius * radius) {
+            result.push_back(point);
+        }
+    }
+    return result;
+}
+
+std::vector<Point*> Map::getAdjacentPoints(int pointId) const {
+    IndexedSpan<Point*> view = adjacentPointsView(pointId);
+    return std::vector<Point*>(view.begin(), view.end());
 }
 
 bool Map::isConnected() const {
@@ -117,6 +316,28 @@ bool Map::isConnected() const {
         return true;  // 空图被认为是连通的
     }
     
+    if (topologyFrozen) {
+        // 在CSR上按稠密索引做BFS，访问标记用连续数组
+        std::vector<char> visited(points.size(), 0);
+        std::vector<int> queue;
+        queue.reserve(points.size());
+        queue.push_back(0);
+        visited[0] = 1;
+        
+        for (size_t head = 0; head < queue.size(); head++) {
+            int current = queue[head];
+            for (int k = csrOffsets[current]; k < csrOffsets[current + 1]; k++) {
+                int next = csrNeighbors[k];
+                if (!visited[next]) {
+                    visited[next] = 1;
+                    queue.push_back(next);
+                }
+            }
+        }
+        
+        return queue.size() == points.size();
+    }
+    
     // 使用BFS检查图的连通性
     std::unordered_set<int> visited;
     std::queue<int> queue;
@@ -130,8 +351,7 @@ bool Map::isConnected() const {
         int currentId = queue.front();
         queue.pop();
         
-        auto roads = getRoadsFromPoint(currentId);
-        for (auto road : roads) {
+        for (Road* road : roadsFromPointView(currentId)) {
             Point* start = road->getStartPoint();
             Point* end = road->getEndPoint();
             
@@ -153,4 +373,162 @@ void Map::rebuildKDTree() {
     delete kdTree;
     kdTree = new KDTree();
     kdTree->build(points);
-}
\ No newline at end of file
+}
+
+void Map::freezeTopology() {
+    const int numPoints = static_cast<int>(points.size());
+    
+    // 第一遍：统计每个点的度数
+    csrOffsets.assign(numPoints + 1, 0);
+    for (auto road : roads) {
+        int startIndex = indexOfPoint(road->getStartPoint()->getId());
+        int endIndex = indexOfPoint(road->getEndPoint()->getId());
+        if (startIndex < 0 || endIndex < 0) {
+            continue;
+        }
+        csrOffsets[startIndex + 1]++;
+        csrOffsets[endIndex + 1]++;
+    }
+    
+    // 前缀和得到每个点的邻接区间
+    for (int i = 0; i < numPoints; i++) {
+        csrOffsets[i + 1] += csrOffsets[i];
+    }
+    
+    // 第二遍：按道路插入顺序填充邻居和边，保持与邻接表一致的遍历顺序
+    csrNeighbors.assign(csrOffsets[numPoints], 0);
+    csrEdges.assign(csrOffsets[numPoints], 0);
+    std::vector<int> cursor(csrOffsets.begin(), csrOffsets.end() - 1);
+    
+    for (int r = 0; r < static_cast<int>(roads.size()); r++) {
+        int startIndex = indexOfPoint(roads[r]->getStartPoint()->getId());
+        int endIndex = indexOfPoint(roads[r]->getEndPoint()->getId());
+        if (startIndex < 0 || endIndex < 0) {
+            continue;
+        }
+        csrNeighbors[cursor[startIndex]] = endIndex;
+        csrEdges[cursor[startIndex]++] = r;
+        csrNeighbors[cursor[endIndex]] = startIndex;
+        csrEdges[cursor[endIndex]++] = r;
+    }
+    
+    topologyFrozen = true;
+}
+
+void Map::rebuildRoadSnapIndex() {
+    roadSnapIndex->build(roads);
+}
+
+void Map::rebuildContractionHierarchy() {
+    std::vector<ContractionHierarchy::Edge> edges;
+    edges.reserve(roads.size());
+    for (size_t r = 0; r < roads.size(); r++) {
+        int startIndex = indexOfPoint(roads[r]->getStartPoint()->getId());
+        int endIndex = indexOfPoint(roads[r]->getEndPoint()->getId());
+        if (startIndex >= 0 && endIndex >= 0) {
+            edges.push_back(ContractionHierarchy::Edge{startIndex, endIndex, roadLengths[r]});
+        }
+    }
+    contractionHierarchy->build(points.size(), edges);
+}
+
+bool Map::restoreContractionHierarchy(const std::vector<int>& ranks, const std::vector<int>& upOffsets,
+                                      const std::vector<int>& upTargets, const std::vector<double>& upWeights,
+                                      const std::vector<int>& upMiddles) {
+    if (ranks.size() != points.size()) {
+        contractionHierarchy->clear();
+        return false;
+    }
+    return contractionHierarchy->buildFromLayout(ranks, upOffsets, upTargets, upWeights, upMiddles);
+}
+
+void Map::rebuildCustomizableHierarchy() {
+    // 每条道路一条输入边，端点无效时以-1占位，使边的下标与 roads 一致
+    std::vector<CustomizableHierarchy::Edge> edges(roads.size());
+    for (size_t r = 0; r < roads.size(); r++) {
+        edges[r].from = indexOfPoint(roads[r]->getStartPoint()->getId());
+        edges[r].to = indexOfPoint(roads[r]->getEndPoint()->getId());
+    }
+    customizableHierarchy->build(points.size(), edges, pointXs.data(), pointYs.data());
+    customizedTravelTimeVersion.store(0, std::memory_order_release);
+}
+
+RoadSnap Map::snapToRoad(double x, double y, double maxDistance) const {
+    return roadSnapIndex->snapToRoad(x, y, maxDistance);
+}
+
+void Map::snapToRoadBatch(const double* xs, const double* ys, size_t count, RoadSnap* out,
+                          double maxDistance) const {
+    roadSnapIndex->snapToRoadBatch(xs, ys, count, out, maxDistance);
+}
+
+Map* Map::createSpatiallyOrdered(std::vector<int>* newPointIds) const {
+    const size_t numPoints = points.size();
+    std::vector<uint32_t> order;
+    SpaceFillingCurve::hilbertOrder(pointXs.data(), pointYs.data(), numPoints, order);
+    
+    Map* ordered = new Map();
+    ordered->reserveCapacity(numPoints, roads.size());
+    
+    // 按曲线顺序创建点，newPoints 按旧的稠密索引记录对应的新点
+    std::vector<Point*> newPoints(numPoints);
+    for (size_t i = 0; i < numPoints; i++) {
+        newPoints[order[i]] = ordered->createPoint(pointXs[order[i]], pointYs[order[i]]);
+    }
+    
+    // 道路按新的端点ID排序，同一个点的道路集中在一起，且与点的顺序一致
+    std::vector<std::pair<uint64_t, int>> roadOrder;
+    roadOrder.reserve(roads.size());
+    for (size_t r = 0; r < roads.size(); r++) {
+        int startIndex = indexOfPoint(roads[r]->getStartPoint()->getId());
+        int endIndex = indexOfPoint(roads[r]->getEndPoint()->getId());
+        if (startIndex < 0 || endIndex < 0) {
+            continue;
+        }
+        roadOrder.emplace_back(edgeKey(newPoints[startIndex]->getId(), newPoints[endIndex]->getId()),
+                               static_cast<int>(r));
+    }
+    std::sort(roadOrder.begin(), roadOrder.end());
+    
+    for (const auto& entry : roadOrder) {
+        const Road* road = roads[entry.second];
+        Road* copy = ordered->createRoad(newPoints[indexOfPoint(road->getStartPoint()->getId())],
+                                         newPoints[indexOfPoint(road->getEndPoint()->getId())]);
+        copy->setCapacity(road->getCapacity());
+        copy->setCurrentCars(road->getCurrentCars());
+    }
+    
+    // 重建原地图上已有的派生结构
+    if (topologyFrozen) {
+        ordered->freezeTopology();
+    }
+    if (!kdTree->empty()) {
+        ordered->kdTree->build(ordered->points, kdTree->getBucketSize());
+    }
+    if (!roadSnapIndex->empty()) {
+        ordered->rebuildRoadSnapIndex();
+    }
+    if (!contractionHierarchy->empty()) {
+        ordered->rebuildContractionHierarchy();
+    }
+    if (!customizableHierarchy->empty()) {
+        ordered->rebuildCustomizableHierarchy();
+    }
+    if (travelTimeVersion > 0) {
+        ordered->updateTravelTimes(travelTimeC, travelTimeThreshold);
+    }
+    
+    if (newPointIds) {
+        newPointIds->resize(numPoints);
+        for (size_t i = 0; i < numPoints; i++) {
+            (*newPointIds)[i] = newPoints[i]->getId();
+        }
+    }
+    return ordered;
+}
+
+void Map::restoreKDTree(const std::vector<Point*>& order, const std::vector<int>& axes, int bucketSize) {
+    delete kdTree;
+    kdTree = new KDTree();
+    kdTree->buildFromLayout(order, axes, bucketSize);
+}
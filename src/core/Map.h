@@ -3,27 +3,109 @@
 
 #include <vector>
 #include <unordered_map>
+#include <cstdint>
+#include <limits>
+#include <algorithm>
+#include <atomic>
+#include <mutex>
 #include "Point.h"
 #include "Road.h"
+#include "RoadTraffic.h"
+#include "IdIndex.h"
+#include "ObjectArena.h"
+#include "Span.h"
 #include "../algorithms/KDTree.h"
+#include "../algorithms/RoadSnapIndex.h"
+#include "../algorithms/ContractionHierarchy.h"
+#include "../algorithms/CustomizableHierarchy.h"
 
 class Map {
 private:
     std::vector<Point*> points;
     std::vector<Road*> roads;
-    std::unordered_map<int, std::vector<Road*>> adjacencyList; // 邻接表表示图
+    
+    // 点坐标的结构数组(SoA)副本，按稠密索引排列，供批量几何计算使用
+    std::vector<double> pointXs;
+    std::vector<double> pointYs;
+    
+    // 点和道路对象的竞技场：按ID顺序连续存放，地图析构时整块释放
+    ObjectArena<Point> pointArena;
+    ObjectArena<Road> roadArena;
+    
+    // 道路交通状态，下标与roads一致；每条道路通过槽位指针读写自己的状态
+    RoadTrafficTable roadTraffic;
+    
+    // 按交通时段(epoch)缓存的道路通行时间，下标与roads一致
+    // 每次交通状态推进后由 updateTravelTimes 整批重算，版本号随之递增
+    std::vector<double> roadLengths;      // 道路长度的连续副本
+    std::vector<double> roadLoadRatios;   // 重算时使用的车流量/容量比
+    std::vector<double> roadTravelTimes;
+    uint64_t travelTimeVersion;
+    double travelTimeC;
+    double travelTimeThreshold;
+    double travelTimeMinFactor;           // 缓存中最小的拥堵因子（通行时间 / (c * 长度)）
+    
+    std::unordered_map<int, std::vector<Road*>> adjacencyList; // 邻接表表示图（生成阶段使用）
+    std::unordered_map<int, std::vector<int>> neighborIndexList; // 与邻接表对应的邻居点稠密索引
     KDTree* kdTree; // KD树用于快速查找最近点
+    RoadSnapIndex* roadSnapIndex; // 道路线段的网格索引，用于把坐标吸附到最近的道路
+    ContractionHierarchy* contractionHierarchy; // 按道路长度预处理的收缩层次，用于最短路径查询
+    CustomizableHierarchy* customizableHierarchy; // 按通行时间定制的可定制收缩层次，用于最快路径查询
+    std::atomic<uint64_t> customizedTravelTimeVersion; // 可定制收缩层次当前权值对应的通行时间版本，0表示未定制
+    std::mutex customizationMutex;                     // 多个查询线程同时触发定制时只让一个执行
+    
+    // 冻结后的压缩稀疏行(CSR)拓扑，按点在points中的下标(稠密索引)组织
+    // 点i的邻居位于 [csrOffsets[i], csrOffsets[i+1]) 区间
+    bool topologyFrozen;
+    std::vector<int> csrOffsets;   // 每个点的邻接区间起始位置，长度为点数+1
+    std::vector<int> csrNeighbors; // 邻居点的稠密索引
+    std::vector<int> csrEdges;     // 对应道路在roads中的下标
+    IdIndex pointIndexById; // 点ID到稠密索引的映射
+    IdIndex roadIndexById;  // 道路ID到roads下标的映射
+    
+    // 边索引：把端点ID对(较小ID, 较大ID)打包成64位键，O(1)查找两点间的道路
+    std::unordered_map<uint64_t, Road*> edgeIndex;
+    
+    static uint64_t edgeKey(int a, int b) {
+        uint32_t lo = static_cast<uint32_t>(std::min(a, b));
+        uint32_t hi = static_cast<uint32_t>(std::max(a, b));
+        return (static_cast<uint64_t>(lo) << 32) | hi;
+    }
+    
+    // 根据点ID获取稠密索引，不存在时返回-1
+    int indexOfPoint(int pointId) const;
+    
+    // 交通状态数组重新分配后，让所有道路指向新的槽位
+    void rebindRoadTraffic();
     
 public:
     Map();
     ~Map();
     
     // 添加点和道路
+    // ID应保持稠密：新点/新道路请使用 getNextPointId()/getNextRoadId() 分配ID，
+    // 这样ID与插入下标一致，按ID查找走数组直接索引；稀疏ID仍可用，但会退化到哈希查找
     void addPoint(Point* point);
     void addRoad(Road* road);
     
+    // 在地图自有的竞技场中创建点/道路并加入地图，ID按稠密顺序自动分配
+    // 通过 addPoint/addRoad 加入的堆对象同样归地图所有，析构时逐个释放
+    Point* createPoint(double x, double y);
+    Road* createRoad(Point* start, Point* end);
+    
+    // 使用指定ID创建（用于从文件恢复地图），调用者负责保证ID稠密
+    Point* createPoint(int id, double x, double y);
+    Road* createRoad(int id, Point* start, Point* end);
+    
+    // 下一个稠密ID
+    int getNextPointId() const { return static_cast<int>(points.size()); }
+    int getNextRoadId() const { return static_cast<int>(roads.size()); }
+    
     // 获取点和道路
     Point* getPointById(int id) const;
+    
+    // 点ID对应的稠密索引（pointsView() 中的下标），不存在时返回-1
+    int getPointIndex(int pointId) const { return indexOfPoint(pointId); }
     Road* getRoadById(int id) const;
     std::vector<Point*> getAllPoints() const;
     std::vector<Road*> getAllRoads() const;
@@ -31,27 +113,161 @@ public:
     // 获取与某点相连的所有道路
     std::vector<Road*> getRoadsFromPoint(int pointId) const;
     
+    // 零拷贝视图：不分配内存，直接引用地图内部存储
+    // 视图在地图被修改（添加点/道路、冻结拓扑）之前有效
+    Span<Point*> pointsView() const { return Span<Point*>(points.data(), points.size()); }
+    Span<Road*> roadsView() const { return Span<Road*>(roads.data(), roads.size()); }
+    IndexedSpan<Road*> roadsFromPointView(int pointId) const;
+    IndexedSpan<Point*> adjacentPointsView(int pointId) const;
+    
+    // 冻结后的CSR拓扑（按稠密索引），拓扑未冻结时为空：点i的邻居稠密索引 csrNeighborsView() 与
+    // 对应道路在 roadsView() 中的下标 csrRoadsView() 位于 [csrOffsetsView()[i], csrOffsetsView()[i + 1])
+    Span<int> csrOffsetsView() const { return topologyFrozen ? Span<int>(csrOffsets.data(), csrOffsets.size()) : Span<int>(); }
+    Span<int> csrNeighborsView() const { return topologyFrozen ? Span<int>(csrNeighbors.data(), csrNeighbors.size()) : Span<int>(); }
+    Span<int> csrRoadsView() const { return topologyFrozen ? Span<int>(csrEdges.data(), csrEdges.size()) : Span<int>(); }
+    
+    // 道路ID对应的 roadsView() 下标，不存在时返回-1
+    int getRoadIndex(int roadId) const { return roadIndexById.find(roadId); }
+    
+    // 道路长度的连续副本，与 roadsView() 一一对应
+    Span<double> roadLengthsView() const { return Span<double>(roadLengths.data(), roadLengths.size()); }
+    
+    // 按roads下标排列的交通状态数组，与 roadsView() 一一对应
+    Span<RoadTraffic> trafficView() const { return Span<RoadTraffic>(roadTraffic.data(), roadTraffic.size()); }
+    
+    // 按当前交通状态整批重算所有道路的通行时间，并递增版本号；
+    // 可定制收缩层次只是随之过期，由下一次最快路径查询通过 prepareCustomizableHierarchy 重新定制
+    void updateTravelTimes(double c, double threshold);
+    
+    // 缓存是否对应给定参数且覆盖所有道路
+    bool hasTravelTimes(double c, double threshold) const {
+        return travelTimeVersion > 0 && roadTravelTimes.size() == roads.size() &&
+               travelTimeC == c && travelTimeThreshold == threshold;
+    }
+    
+    // 缓存的通行时间（下标与 roadsView() 一致）及其版本号，版本号为0表示尚未计算
+    Span<double> travelTimesView() const { return Span<double>(roadTravelTimes.data(), roadTravelTimes.size()); }
+    uint64_t getTravelTimeVersion() const { return travelTimeVersion; }
+    
+    // 读取道路的通行时间：缓存与参数匹配时直接查表，否则现场计算
+    double getRoadTravelTime(const Road* road, double c, double threshold) const;
+    
+    // 所有道路拥堵因子的下界，用于最快路径的A*启发式：缓存与参数匹配时为缓存中的最小值，
+    // 否则为1（拥堵因子不会小于1）
+    double getMinCongestionFactor(double c, double threshold) const {
+        return hasTravelTimes(c, threshold) ? travelTimeMinFactor : 1.0;
+    }
+    
+    // 按稠密索引排列的坐标数组，与 pointsView() 一一对应
+    Span<double> xCoordinates() const { return Span<double>(pointXs.data(), pointXs.size()); }
+    Span<double> yCoordinates() const { return Span<double>(pointYs.data(), pointYs.size()); }
+    
+    // 获取矩形区域（含边界）内的所有点，用于视口查询；顺序不定
+    // KD树与当前点集一致时走树上的剪枝查询，否则在SoA坐标上做向量化扫描
+    std::vector<Point*> getPointsInRect(double minX, double minY, double maxX, double maxY) const;
+    
+    // 获取到 (x, y) 距离不超过 radius 的所有点；顺序不定
+    std::vector<Point*> getPointsWithinRadius(double x, double y, double radius) const;
+    
     // 获取两点之间的道路（如果存在）
     Road* getRoadBetweenPoints(int startId, int endId) const;
     
     // 获取指定坐标附近的点
     std::vector<Point*> getNearestPoints(double x, double y, int count) const;
     
+    // 同上，结果写入调用者提供的数组（容量至少为count），返回写入的数量，不分配内存
+    int getNearestPoints(double x, double y, int count, Point** results) const;
+    
+    // 批量查询每个坐标附近的点（如一批GPS定位），结果为CSR形式：
+    // 第i个查询的结果为 results[offsets[i], offsets[i + 1])，查询在线程池上并行执行
+    void getNearestPointsBatch(const double* xs, const double* ys, size_t numQueries, int count,
+                               std::vector<size_t>& offsets, std::vector<Point*>& results) const;
+    
     // 获取与指定点相连的所有点
     std::vector<Point*> getAdjacentPoints(int pointId) const;
     
     // 检查图是否连通
     bool isConnected() const;
     
-    // 重建KD树
+    // 批量重建KD树；树构建后 addPoint 会增量插入新点，编辑地图后无需再调用
     void rebuildKDTree();
     
+    // KD树访问：用于保存/恢复已构建的树
+    const KDTree* getKDTree() const { return kdTree; }
+    bool isKDTreeBuilt() const { return !kdTree->empty(); }
+    void restoreKDTree(const std::vector<Point*>& order, const std::vector<int>& axes, int bucketSize);
+    
+    // 批量重建道路吸附索引；构建后 addRoad 会增量加入新道路
+    void rebuildRoadSnapIndex();
+    bool isRoadSnapIndexBuilt() const { return !roadSnapIndex->empty(); }
+    
+    // 按道路长度构建收缩层次（按稠密索引组织）。收缩层次不支持增量更新，
+    // 之后添加点或道路会使它失效，需要重新构建
+    void rebuildContractionHierarchy();
+    bool isContractionHierarchyBuilt() const { return !contractionHierarchy->empty(); }
+    const ContractionHierarchy* getContractionHierarchy() const { return contractionHierarchy; }
+    
+    // 从地图文件恢复收缩层次（参数含义见 ContractionHierarchy::buildFromLayout），点数不符或数据不一致时返回 false
+    bool restoreContractionHierarchy(const std::vector<int>& ranks, const std::vector<int>& upOffsets,
+                                     const std::vector<int>& upTargets, const std::vector<double>& upWeights,
+                                     const std::vector<int>& upMiddles);
+    
+    // 按拓扑和点的位置构建可定制收缩层次（与通行时间无关），构建后尚未定制。
+    // 添加点或道路会使它失效；不必预先调用，prepareCustomizableHierarchy 在第一次需要时构建
+    void rebuildCustomizableHierarchy();
+    bool isCustomizableHierarchyBuilt() const { return !customizableHierarchy->empty(); }
+    const CustomizableHierarchy* getCustomizableHierarchy() const { return customizableHierarchy; }
+    
+    // 可定制收缩层次的权值是否就是给定参数下的当前通行时间
+    bool isCustomizableHierarchyReady(double c, double threshold) const {
+        // 先读版本号：它在构建和定制完成后才发布，之后读取层次结构是安全的
+        return hasTravelTimes(c, threshold) &&
+               customizedTravelTimeVersion.load(std::memory_order_acquire) == travelTimeVersion &&
+               customizableHierarchy->isCustomized();
+    }
+    
+    // 延迟构建和定制：尚未构建时先构建（与通行时间无关，只做一次），通行时间更新后第一次需要
+    // 可定制收缩层次的查询才用当前通行时间重新定制，同一交通时段内的后续查询直接使用。
+    // 返回能否使用（地图为空或参数与缓存不符时为 false）。
+    // 可以从多个查询线程同时调用，只有一个线程执行构建和定制；不能与 updateTravelTimes 并发
+    bool prepareCustomizableHierarchy(double c, double threshold);
+    
+    // 把坐标吸附到最近的道路上（需先构建道路吸附索引），超过 maxDistance 时返回的 road 为空
+    RoadSnap snapToRoad(double x, double y,
+                        double maxDistance = std::numeric_limits<double>::infinity()) const;
+    
+    // 批量吸附（如一批GPS定位），out[i] 为第i个坐标的结果，查询在线程池上并行执行
+    void snapToRoadBatch(const double* xs, const double* ys, size_t count, RoadSnap* out,
+                         double maxDistance = std::numeric_limits<double>::infinity()) const;
+    
+    // 按 Hilbert 曲线顺序重新编号，返回一张新地图：点ID为点在曲线上的序号，道路按新的
+    // (较小端点ID, 较大端点ID) 排序后编号，交通状态随道路复制。空间上相邻的点和道路在
+    // 竞技场和各个数组中也相邻，路径搜索、KD树遍历和渲染访问的内存更集中。
+    // 原地图已构建的CSR拓扑、KD树、道路吸附索引、（可定制）收缩层次和通行时间缓存会在新地图上重建。
+    // newPointIds 不为空时写入每个旧点对应的新ID（按旧地图的稠密索引排列）
+    Map* createSpatiallyOrdered(std::vector<int>* newPointIds = nullptr) const;
+    
+    // 生成完成后冻结拓扑，构建CSR表示；之后再添加道路会自动解冻
+    void freezeTopology();
+    bool isTopologyFrozen() const { return topologyFrozen; }
+    
     // 添加预分配内存的方法
     void reserveCapacity(size_t numPoints, size_t numRoads) {
         points.reserve(numPoints);
         roads.reserve(numRoads);
+        roadLengths.reserve(numRoads);
+        pointXs.reserve(numPoints);
+        pointYs.reserve(numPoints);
+        pointArena.reserve(numPoints);
+        roadArena.reserve(numRoads);
+        if (roadTraffic.reserve(numRoads)) {
+            rebindRoadTraffic();
+        }
         // 为邻接表预分配空间
         adjacencyList.reserve(numPoints);
+        pointIndexById.reserve(numPoints);
+        roadIndexById.reserve(numRoads);
+        edgeIndex.reserve(numRoads);
     }
 };
 
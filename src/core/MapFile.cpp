@@ -0,0 +1,334 @@
+#include "MapFile.h"
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <vector>
+
+#ifdef _WIN32
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#endif
+
+namespace {
+
+const char MAP_FILE_MAGIC[8] = {'N', 'A', 'V', 'M', 'A', 'P', '\0', '\0'};
+const uint32_t ENDIAN_MARK = 0x01020304;
+const uint32_t FLAG_HAS_KDTREE = 1u << 0;
+const uint32_t FLAG_HAS_CONTRACTION_HIERARCHY = 1u << 1;
+
+struct Header {
+    char magic[8];
+    uint32_t version;
+    uint32_t endianMark;
+    uint32_t flags;
+    uint32_t kdBucketSize;  // KD树叶子桶大小，0与1都表示每个点一个节点
+    uint64_t numPoints;
+    uint64_t numRoads;
+    uint64_t numKDNodes;
+    uint64_t pointsOffset;
+    uint64_t roadsOffset;
+    uint64_t kdOffset;
+    uint64_t fileSize;
+    uint64_t sourceKey;     // 调用者给出的来源参数键，MapFile 不解释
+    uint64_t numCHArcs;
+    uint64_t chRanksOffset;  // numPoints 个 int32
+    uint64_t chOffsetsOffset; // numPoints + 1 个 int32
+    uint64_t chArcsOffset;
+};
+
+struct PointRecord {
+    int32_t id;
+    int32_t reserved;
+    double x;
+    double y;
+};
+
+struct RoadRecord {
+    int32_t id;
+    int32_t startIndex;
+    int32_t endIndex;
+    int32_t capacity;
+};
+
+struct KDRecord {
+    int32_t pointIndex;
+    int32_t splitAxis;
+};
+
+struct CHArcRecord {
+    int32_t target;
+    int32_t middle;  // 捷径绕过的点，原始道路为-1
+    double weight;
+};
+
+uint64_t alignTo8(uint64_t offset) {
+    return (offset + 7) & ~static_cast<uint64_t>(7);
+}
+
+// 把整个文件读入按8字节对齐的缓冲区，失败或文件为空时返回 false
+bool readWholeFile(const std::string& path, std::vector<uint64_t>& buffer, uint64_t& fileSize) {
+    std::ifstream in(path, std::ios::binary | std::ios::ate);
+    if (!in) {
+        return false;
+    }
+    std::streamoff size = in.tellg();
+    if (size <= 0) {
+        return false;
+    }
+    fileSize = static_cast<uint64_t>(size);
+    buffer.assign((fileSize + 7) / 8, 0);
+    in.seekg(0);
+    in.read(reinterpret_cast<char*>(buffer.data()), static_cast<std::streamsize>(fileSize));
+    return static_cast<uint64_t>(in.gcount()) == fileSize;
+}
+
+// 检查段 [offset, offset + count * recordSize) 是否完整落在文件内
+bool sectionFits(uint64_t offset, uint64_t count, uint64_t recordSize, uint64_t fileSize) {
+    if (offset % 8 != 0 || offset > fileSize) return false;
+    if (recordSize != 0 && count > (fileSize - offset) / recordSize) return false;
+    return true;
+}
+
+} // namespace
+
+bool MapFile::save(const Map& map, const std::string& path, bool includeKDTree, uint64_t sourceKey) {
+    Span<Point*> points = map.pointsView();
+    Span<Road*> roads = map.roadsView();
+
+    // 点ID到写入下标的映射，道路用下标引用端点
+    IdIndex pointIndex;
+    pointIndex.reserve(points.size());
+    for (size_t i = 0; i < points.size(); i++) {
+        pointIndex.insert(points[i]->getId(), static_cast<int>(i));
+    }
+
+    std::vector<Point*> kdOrder;
+    std::vector<int> kdAxes;
+    if (includeKDTree && map.isKDTreeBuilt()) {
+        map.getKDTree()->exportLayout(kdOrder, kdAxes);
+    }
+
+    // 收缩层次按稠密索引组织，与点的写入顺序一致，直接保存
+    std::vector<int> chRanks, chOffsets, chTargets, chMiddles;
+    std::vector<double> chWeights;
+    if (map.isContractionHierarchyBuilt()) {
+        map.getContractionHierarchy()->exportLayout(chRanks, chOffsets, chTargets, chWeights, chMiddles);
+    }
+    std::vector<CHArcRecord> chArcRecords(chTargets.size());
+    for (size_t i = 0; i < chTargets.size(); i++) {
+        chArcRecords[i].target = chTargets[i];
+        chArcRecords[i].middle = chMiddles[i];
+        chArcRecords[i].weight = chWeights[i];
+    }
+
+    Header header;
+    std::memset(&header, 0, sizeof(header));
+    std::memcpy(header.magic, MAP_FILE_MAGIC, sizeof(header.magic));
+    header.version = FORMAT_VERSION;
+    header.endianMark = ENDIAN_MARK;
+    header.flags = (kdOrder.empty() ? 0 : FLAG_HAS_KDTREE) | (chRanks.empty() ? 0 : FLAG_HAS_CONTRACTION_HIERARCHY);
+    header.numPoints = points.size();
+    header.numRoads = roads.size();
+    header.numKDNodes = kdOrder.size();
+    header.kdBucketSize = kdOrder.empty() ? 0 : static_cast<uint32_t>(map.getKDTree()->getBucketSize());
+    header.pointsOffset = alignTo8(sizeof(Header));
+    header.roadsOffset = alignTo8(header.pointsOffset + header.numPoints * sizeof(PointRecord));
+    header.kdOffset = alignTo8(header.roadsOffset + header.numRoads * sizeof(RoadRecord));
+    header.numCHArcs = chArcRecords.size();
+    header.chRanksOffset = alignTo8(header.kdOffset + header.numKDNodes * sizeof(KDRecord));
+    header.chOffsetsOffset = alignTo8(header.chRanksOffset + chRanks.size() * sizeof(int32_t));
+    header.chArcsOffset = alignTo8(header.chOffsetsOffset + chOffsets.size() * sizeof(int32_t));
+    header.fileSize = header.chArcsOffset + header.numCHArcs * sizeof(CHArcRecord);
+    header.sourceKey = sourceKey;
+
+    std::vector<PointRecord> pointRecords(points.size());
+    for (size_t i = 0; i < points.size(); i++) {
+        pointRecords[i].id = points[i]->getId();
+        pointRecords[i].reserved = 0;
+        pointRecords[i].x = points[i]->getX();
+        pointRecords[i].y = points[i]->getY();
+    }
+
+    std::vector<RoadRecord> roadRecords(roads.size());
+    for (size_t i = 0; i < roads.size(); i++) {
+        roadRecords[i].id = roads[i]->getId();
+        roadRecords[i].startIndex = pointIndex.find(roads[i]->getStartPoint()->getId());
+        roadRecords[i].endIndex = pointIndex.find(roads[i]->getEndPoint()->getId());
+        roadRecords[i].capacity = roads[i]->getCapacity();
+        if (roadRecords[i].startIndex < 0 || roadRecords[i].endIndex < 0) {
+            std::cerr << "MapFile::save: 道路 " << roads[i]->getId() << " 的端点不在地图中" << std::endl;
+            return false;
+        }
+    }
+
+    std::vector<KDRecord> kdRecords(kdOrder.size());
+    for (size_t i = 0; i < kdOrder.size(); i++) {
+        kdRecords[i].pointIndex = pointIndex.find(kdOrder[i]->getId());
+        kdRecords[i].splitAxis = kdAxes[i];
+    }
+
+    // 先写临时文件再替换，避免其他进程读到写了一半的文件
+    std::string tempPath = path + ".tmp";
+    {
+        std::ofstream out(tempPath, std::ios::binary | std::ios::trunc);
+        if (!out) {
+            std::cerr << "MapFile::save: 无法写入文件 " << tempPath << std::endl;
+            return false;
+        }
+
+        auto writeAt = [&out](uint64_t offset, const void* data, size_t bytes) {
+            static const char zeros[8] = {0};
+            uint64_t position = static_cast<uint64_t>(out.tellp());
+            if (position < offset) {
+                out.write(zeros, static_cast<std::streamsize>(offset - position));
+            }
+            if (bytes > 0) {
+                out.write(static_cast<const char*>(data), static_cast<std::streamsize>(bytes));
+            }
+        };
+
+        writeAt(0, &header, sizeof(header));
+        writeAt(header.pointsOffset, pointRecords.data(), pointRecords.size() * sizeof(PointRecord));
+        writeAt(header.roadsOffset, roadRecords.data(), roadRecords.size() * sizeof(RoadRecord));
+        writeAt(header.kdOffset, kdRecords.data(), kdRecords.size() * sizeof(KDRecord));
+        writeAt(header.chRanksOffset, chRanks.data(), chRanks.size() * sizeof(int32_t));
+        writeAt(header.chOffsetsOffset, chOffsets.data(), chOffsets.size() * sizeof(int32_t));
+        writeAt(header.chArcsOffset, chArcRecords.data(), chArcRecords.size() * sizeof(CHArcRecord));
+
+        if (!out) {
+            std::cerr << "MapFile::save: 写入文件失败 " << tempPath << std::endl;
+            return false;
+        }
+    }
+
+    // 原子地替换旧文件：任何时刻目标路径上要么是完整的旧文件，要么是完整的新文件
+#ifdef _WIN32
+    bool replaced = MoveFileExA(tempPath.c_str(), path.c_str(), MOVEFILE_REPLACE_EXISTING) != 0;
+#else
+    bool replaced = std::rename(tempPath.c_str(), path.c_str()) == 0;
+#endif
+    if (!replaced) {
+        std::cerr << "MapFile::save: 无法重命名为 " << path << std::endl;
+        std::remove(tempPath.c_str());
+        return false;
+    }
+    return true;
+}
+
+Map* MapFile::load(const std::string& path, uint64_t* sourceKey) {
+    std::vector<uint64_t> buffer;
+    uint64_t fileSize = 0;
+    if (!readWholeFile(path, buffer, fileSize)) {
+        return nullptr;
+    }
+
+    const unsigned char* base = reinterpret_cast<const unsigned char*>(buffer.data());
+
+    if (fileSize < sizeof(Header)) {
+        std::cerr << "MapFile::load: 文件过小 " << path << std::endl;
+        return nullptr;
+    }
+
+    Header header;
+    std::memcpy(&header, base, sizeof(header));
+
+    if (std::memcmp(header.magic, MAP_FILE_MAGIC, sizeof(header.magic)) != 0 ||
+        header.endianMark != ENDIAN_MARK) {
+        std::cerr << "MapFile::load: 不是地图文件或字节序不匹配 " << path << std::endl;
+        return nullptr;
+    }
+    if (header.version != FORMAT_VERSION) {
+        std::cerr << "MapFile::load: 不支持的文件版本 " << header.version << std::endl;
+        return nullptr;
+    }
+    if (header.fileSize != fileSize ||
+        header.numPoints > static_cast<uint64_t>(INT32_MAX) ||
+        header.numRoads > static_cast<uint64_t>(INT32_MAX) ||
+        !sectionFits(header.pointsOffset, header.numPoints, sizeof(PointRecord), fileSize) ||
+        !sectionFits(header.roadsOffset, header.numRoads, sizeof(RoadRecord), fileSize) ||
+        !sectionFits(header.kdOffset, header.numKDNodes, sizeof(KDRecord), fileSize) ||
+        !sectionFits(header.chArcsOffset, header.numCHArcs, sizeof(CHArcRecord), fileSize)) {
+        std::cerr << "MapFile::load: 文件头损坏 " << path << std::endl;
+        return nullptr;
+    }
+
+    const PointRecord* pointRecords = reinterpret_cast<const PointRecord*>(base + header.pointsOffset);
+    const RoadRecord* roadRecords = reinterpret_cast<const RoadRecord*>(base + header.roadsOffset);
+    const KDRecord* kdRecords = reinterpret_cast<const KDRecord*>(base + header.kdOffset);
+
+    const int numPoints = static_cast<int>(header.numPoints);
+    const int numRoads = static_cast<int>(header.numRoads);
+
+    Map* map = new Map();
+    map->reserveCapacity(numPoints, numRoads);
+
+    std::vector<Point*> points(numPoints);
+    for (int i = 0; i < numPoints; i++) {
+        points[i] = map->createPoint(pointRecords[i].id, pointRecords[i].x, pointRecords[i].y);
+    }
+
+    for (int i = 0; i < numRoads; i++) {
+        const RoadRecord& record = roadRecords[i];
+        if (record.startIndex < 0 || record.startIndex >= numPoints ||
+            record.endIndex < 0 || record.endIndex >= numPoints) {
+            std::cerr << "MapFile::load: 道路记录损坏 " << path << std::endl;
+            delete map;
+            return nullptr;
+        }
+        Road* road = map->createRoad(record.id, points[record.startIndex], points[record.endIndex]);
+        road->setCapacity(record.capacity);
+    }
+
+    map->freezeTopology();
+
+    // 恢复KD树；记录不完整时留给调用者重建
+    if ((header.flags & FLAG_HAS_KDTREE) && header.numKDNodes == header.numPoints) {
+        std::vector<Point*> kdOrder(numPoints);
+        std::vector<int> kdAxes(numPoints);
+        bool valid = true;
+        for (int i = 0; i < numPoints && valid; i++) {
+            int index = kdRecords[i].pointIndex;
+            valid = index >= 0 && index < numPoints &&
+                    (kdRecords[i].splitAxis == 0 || kdRecords[i].splitAxis == 1);
+            if (valid) {
+                kdOrder[i] = points[index];
+                kdAxes[i] = kdRecords[i].splitAxis;
+            }
+        }
+        if (valid) {
+            map->restoreKDTree(kdOrder, kdAxes, static_cast<int>(std::max<uint32_t>(header.kdBucketSize, 1)));
+        }
+    }
+
+    // 恢复收缩层次；段不完整或数据不一致时留给调用者重建
+    if ((header.flags & FLAG_HAS_CONTRACTION_HIERARCHY) && numPoints > 0 &&
+        header.numCHArcs <= static_cast<uint64_t>(INT32_MAX) &&
+        sectionFits(header.chRanksOffset, header.numPoints, sizeof(int32_t), fileSize) &&
+        sectionFits(header.chOffsetsOffset, header.numPoints + 1, sizeof(int32_t), fileSize)) {
+        const int32_t* chRanks = reinterpret_cast<const int32_t*>(base + header.chRanksOffset);
+        const int32_t* chOffsets = reinterpret_cast<const int32_t*>(base + header.chOffsetsOffset);
+        const CHArcRecord* chArcs = reinterpret_cast<const CHArcRecord*>(base + header.chArcsOffset);
+        std::vector<int> ranks(chRanks, chRanks + numPoints);
+        std::vector<int> offsets(chOffsets, chOffsets + numPoints + 1);
+        std::vector<int> targets(header.numCHArcs);
+        std::vector<int> middles(header.numCHArcs);
+        std::vector<double> weights(header.numCHArcs);
+        for (size_t i = 0; i < targets.size(); i++) {
+            targets[i] = chArcs[i].target;
+            middles[i] = chArcs[i].middle;
+            weights[i] = chArcs[i].weight;
+        }
+        if (!map->restoreContractionHierarchy(ranks, offsets, targets, weights, middles)) {
+            std::cerr << "MapFile::load: 收缩层次数据不一致，需要重新构建 " << path << std::endl;
+        }
+    }
+
+    if (sourceKey) {
+        *sourceKey = header.sourceKey;
+    }
+    return map;
+}
@@ -0,0 +1,38 @@
+#ifndef MAP_FILE_H
+#define MAP_FILE_H
+
+#include <string>
+#include <cstdint>
+#include "Map.h"
+
+// 地图二进制文件格式（带版本号）
+//
+// 文件布局（本机字节序，所有段按8字节对齐）：
+//   Header        固定大小的文件头，包含魔数、版本号、字节序标记、来源参数键和各段的偏移/数量
+//   PointRecord[] 点：ID和坐标，按地图中的插入顺序
+//   RoadRecord[]  道路：ID、两端点在点数组中的下标、容量
+//   KDRecord[]    可选：已构建KD树的隐式布局（中序位置上的点下标和分割轴），
+//                 叶子桶大小记录在文件头中
+//   int32[]       可选：收缩层次中每个点的层级，接着是上行图的偏移数组（点数 + 1 项）
+//   CHArcRecord[] 可选：收缩层次的上行边（目标点下标、捷径绕过的点、权值）
+//
+// 加载时把整个文件一次读入内存，再按记录在地图的竞技场中重建点和道路，
+// 并重建CSR拓扑、恢复KD树的布局和收缩层次。加载不是零拷贝的，省下的是生成地图、
+// 构建KD树和收缩路网（大地图上要十几秒）的开销
+//
+// 来源参数键由调用者给出（例如生成器参数的哈希），加载时原样返回，
+// 用作缓存的调用者据此判断文件是否由当前参数生成
+class MapFile {
+public:
+    static const uint32_t FORMAT_VERSION = 3;
+
+    // 保存地图，includeKDTree 为 true 且树已构建时一并保存KD树；收缩层次已构建时一并保存；
+    // sourceKey 写入文件头
+    static bool save(const Map& map, const std::string& path, bool includeKDTree = true, uint64_t sourceKey = 0);
+
+    // 加载地图，文件不存在、版本不符或内容损坏时返回 nullptr；
+    // sourceKey 不为空时写入文件头中的来源参数键
+    static Map* load(const std::string& path, uint64_t* sourceKey = nullptr);
+};
+
+#endif // MAP_FILE_H
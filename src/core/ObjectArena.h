@@ -0,0 +1,92 @@
+#ifndef OBJECT_ARENA_H
+#define OBJECT_ARENA_H
+
+#include <cstddef>
+#include <new>
+#include <utility>
+#include <vector>
+#include <type_traits>
+
+// 简单的对象竞技场（slab分配器）
+// 对象按创建顺序连续存放在大块内存中，地址在整个生命周期内保持不变，
+// 析构时整块释放。预先 reserve 足够容量时所有对象都位于同一块内存中
+template<typename T>
+class ObjectArena {
+private:
+    struct Block {
+        T* data;
+        size_t used;
+        size_t capacity;
+    };
+
+    std::vector<Block> blocks;
+    size_t count;
+    size_t minBlockSize;
+
+    void addBlock(size_t capacity) {
+        T* data = static_cast<T*>(::operator new(capacity * sizeof(T)));
+        blocks.push_back({data, 0, capacity});
+    }
+
+public:
+    explicit ObjectArena(size_t minBlockSize = 1024) : count(0), minBlockSize(minBlockSize) {}
+    ~ObjectArena() { clear(); }
+
+    ObjectArena(const ObjectArena&) = delete;
+    ObjectArena& operator=(const ObjectArena&) = delete;
+
+    // 确保还能再连续放下n个对象
+    void reserve(size_t n) {
+        if (!blocks.empty() && blocks.back().capacity - blocks.back().used >= n) {
+            return;
+        }
+        // 当前块剩余空间不足时，如果它还是空的就直接替换掉
+        if (!blocks.empty() && blocks.back().used == 0) {
+            ::operator delete(blocks.back().data);
+            blocks.pop_back();
+        }
+        addBlock(n);
+    }
+
+    // 在竞技场中构造一个对象
+    template<typename... Args>
+    T* create(Args&&... args) {
+        if (blocks.empty() || blocks.back().used == blocks.back().capacity) {
+            // 按几何级数增长，块数量保持在对数级别
+            addBlock(count > minBlockSize ? count : minBlockSize);
+        }
+        Block& block = blocks.back();
+        T* object = new (block.data + block.used) T(std::forward<Args>(args)...);
+        block.used++;
+        count++;
+        return object;
+    }
+
+    // 判断对象是否由本竞技场分配
+    bool contains(const T* object) const {
+        for (const Block& block : blocks) {
+            if (object >= block.data && object < block.data + block.used) {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    size_t size() const { return count; }
+
+    // 批量释放所有对象
+    void clear() {
+        for (Block& block : blocks) {
+            if (!std::is_trivially_destructible<T>::value) {
+                for (size_t i = 0; i < block.used; i++) {
+                    block.data[i].~T();
+                }
+            }
+            ::operator delete(block.data);
+        }
+        blocks.clear();
+        count = 0;
+    }
+};
+
+#endif // OBJECT_ARENA_H
@@ -5,8 +5,7 @@ Road::Road(int id, Point* start, Point* end) :
     id(id), 
     startPoint(start), 
     endPoint(end), 
-    capacity(5),  // 默认容量值
-    currentCars(0)  // 初始车辆数为0
+    traffic(&detachedTraffic)  // 默认容量5，初始车辆数0
 {
     // 计算道路长度为两点之间的距离
     length = start->distanceTo(*end);
@@ -29,23 +28,31 @@ double Road::getLength() const {
 }
 
 int Road::getCapacity() const {
-    return capacity;
+    return traffic->getCapacity();
 }
 
 int Road::getCurrentCars() const {
-    return currentCars;
+    return traffic->getCurrentCars();
 }
 
 void Road::setCapacity(int v) {
-    capacity = v;
+    traffic->setCapacity(v);
 }
 
 void Road::setCurrentCars(int n) {
-    currentCars = n;
+    traffic->setCurrentCars(n);
+}
+
+void Road::addCurrentCars(int delta) {
+    traffic->addCars(delta);
+}
+
+void Road::bindTraffic(RoadTraffic* slot) {
+    traffic = slot;
 }
 
 double Road::getTravelTime(double c, double threshold) const {
-    double ratio = static_cast<double>(currentCars) / capacity;
+    double ratio = static_cast<double>(getCurrentCars()) / getCapacity();
     double factor = 1.0;
     
     // 当车流量/容量比超过阈值时，拥堵因子增加
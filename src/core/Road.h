@@ -2,29 +2,43 @@
 #define ROAD_H
 
 #include "Point.h"
+#include "RoadTraffic.h"
 
 class Road {
 private:
+    // 拓扑数据（冷数据，创建后不再改变）
     int id;
     Point* startPoint;
     Point* endPoint;
     double length;      // 道路长度
-    int capacity;       // 车容量v
-    int currentCars;    // 当前车辆数n
-    
+
+    // 交通状态（热数据）存放在地图的连续数组中，这里只保存槽位指针；
+    // 道路尚未加入地图时指向自带的 detachedTraffic
+    RoadTraffic* traffic;
+    RoadTraffic detachedTraffic;
+
 public:
     Road(int id, Point* start, Point* end);
-    
+
+    Road(const Road&) = delete;
+    Road& operator=(const Road&) = delete;
+
     int getId() const;
     Point* getStartPoint() const;
     Point* getEndPoint() const;
     double getLength() const;
     int getCapacity() const;
     int getCurrentCars() const;
-    
+
     void setCapacity(int v);
     void setCurrentCars(int n);
-    
+
+    // 原子地增减当前车辆数，可在多个线程中调用
+    void addCurrentCars(int delta);
+
+    // 由地图调用：把交通状态改为存放在指定槽位（槽位中的值由调用者负责初始化）
+    void bindTraffic(RoadTraffic* slot);
+
     // 计算通行时间
     double getTravelTime(double c, double threshold) const;
 };
@@ -0,0 +1,81 @@
+#ifndef ROAD_TRAFFIC_H
+#define ROAD_TRAFFIC_H
+
+#include <atomic>
+#include <cstddef>
+
+// 一条道路的实时交通状态（热数据）
+// 与道路拓扑（端点、长度）分开存放，模拟器的写入不会和路径规划读取的数据共享缓存行。
+// 计数器使用 relaxed 原子操作，多个线程可以同时更新不同车辆所在的道路
+struct RoadTraffic {
+    std::atomic<int> currentCars; // 当前车辆数n
+    std::atomic<int> capacity;    // 车容量v
+
+    RoadTraffic() : currentCars(0), capacity(5) {}
+
+    int getCurrentCars() const { return currentCars.load(std::memory_order_relaxed); }
+    int getCapacity() const { return capacity.load(std::memory_order_relaxed); }
+    void setCurrentCars(int n) { currentCars.store(n, std::memory_order_relaxed); }
+    void setCapacity(int v) { capacity.store(v, std::memory_order_relaxed); }
+
+    // 原子地增减车辆数，返回修改后的值
+    int addCars(int delta) { return currentCars.fetch_add(delta, std::memory_order_relaxed) + delta; }
+};
+
+// 按道路下标排列的连续交通状态数组
+// 原子类型不可移动，所以自行管理内存：扩容时把旧值逐个拷贝到新数组，
+// 返回 true 通知调用者重新绑定指向旧槽位的道路。扩容只应发生在构建地图阶段，
+// 此时不能有其他线程在更新交通状态
+class RoadTrafficTable {
+private:
+    RoadTraffic* slots;
+    size_t count;
+    size_t allocated;
+
+    void reallocate(size_t newCapacity) {
+        RoadTraffic* newSlots = new RoadTraffic[newCapacity];
+        for (size_t i = 0; i < count; i++) {
+            newSlots[i].setCurrentCars(slots[i].getCurrentCars());
+            newSlots[i].setCapacity(slots[i].getCapacity());
+        }
+        delete[] slots;
+        slots = newSlots;
+        allocated = newCapacity;
+    }
+
+public:
+    RoadTrafficTable() : slots(nullptr), count(0), allocated(0) {}
+    ~RoadTrafficTable() { delete[] slots; }
+
+    RoadTrafficTable(const RoadTrafficTable&) = delete;
+    RoadTrafficTable& operator=(const RoadTrafficTable&) = delete;
+
+    // 预留空间，发生了重新分配时返回 true
+    bool reserve(size_t n) {
+        if (n <= allocated) {
+            return false;
+        }
+        reallocate(n);
+        return true;
+    }
+
+    // 在末尾追加一个槽位并写入初始值，发生了重新分配时返回 true
+    bool append(int capacity, int currentCars) {
+        bool moved = false;
+        if (count == allocated) {
+            reallocate(allocated < 1024 ? 1024 : allocated * 2);
+            moved = true;
+        }
+        slots[count].setCapacity(capacity);
+        slots[count].setCurrentCars(currentCars);
+        count++;
+        return moved;
+    }
+
+    RoadTraffic& operator[](size_t i) { return slots[i]; }
+    const RoadTraffic& operator[](size_t i) const { return slots[i]; }
+    const RoadTraffic* data() const { return slots; }
+    size_t size() const { return count; }
+};
+
+#endif // ROAD_TRAFFIC_H
@@ -0,0 +1,96 @@
+#include "SpaceFillingCurve.h"
+#include <algorithm>
+#include <limits>
+
+namespace SpaceFillingCurve {
+
+namespace {
+
+// 把16位整数的各位分散到偶数位上
+uint32_t spreadBits(uint32_t v) {
+    v &= 0x0000FFFF;
+    v = (v | (v << 8)) & 0x00FF00FF;
+    v = (v | (v << 4)) & 0x0F0F0F0F;
+    v = (v | (v << 2)) & 0x33333333;
+    v = (v | (v << 1)) & 0x55555555;
+    return v;
+}
+
+// 把坐标按包围盒的下界和缩放系数量化到 [0, 65535]
+uint32_t quantize(double value, double minValue, double scale) {
+    double cell = (value - minValue) * scale;
+    if (!(cell > 0.0)) {
+        return 0;
+    }
+    return static_cast<uint32_t>(std::min(cell, 65535.0));
+}
+
+// 把点量化到包围盒内的网格上，按 curveCode 给出的曲线码排序
+template<typename CurveCode>
+void sortAlongCurve(const double* xs, const double* ys, size_t n, std::vector<uint32_t>& order, CurveCode curveCode) {
+    order.resize(n);
+    if (n == 0) {
+        return;
+    }
+    
+    double minX = std::numeric_limits<double>::infinity();
+    double minY = std::numeric_limits<double>::infinity();
+    double maxX = -std::numeric_limits<double>::infinity();
+    double maxY = -std::numeric_limits<double>::infinity();
+    for (size_t i = 0; i < n; i++) {
+        minX = std::min(minX, xs[i]);
+        maxX = std::max(maxX, xs[i]);
+        minY = std::min(minY, ys[i]);
+        maxY = std::max(maxY, ys[i]);
+    }
+    double scaleX = (maxX > minX) ? 65535.0 / (maxX - minX) : 0.0;
+    double scaleY = (maxY > minY) ? 65535.0 / (maxY - minY) : 0.0;
+    
+    // 高32位为曲线码、低32位为原下标，一次整数排序同时得到稳定的顺序
+    std::vector<uint64_t> keys(n);
+    for (size_t i = 0; i < n; i++) {
+        uint32_t code = curveCode(quantize(xs[i], minX, scaleX), quantize(ys[i], minY, scaleY));
+        keys[i] = (static_cast<uint64_t>(code) << 32) | static_cast<uint32_t>(i);
+    }
+    std::sort(keys.begin(), keys.end());
+    for (size_t i = 0; i < n; i++) {
+        order[i] = static_cast<uint32_t>(keys[i]);
+    }
+}
+
+} // namespace
+
+uint32_t mortonCode(uint32_t gridX, uint32_t gridY) {
+    return spreadBits(gridX) | (spreadBits(gridY) << 1);
+}
+
+uint32_t hilbertCode(uint32_t gridX, uint32_t gridY) {
+    uint32_t x = gridX & 0xFFFF;
+    uint32_t y = gridY & 0xFFFF;
+    uint32_t code = 0;
+    
+    // 从最高位开始，每一位确定所在的象限，再把坐标旋转/翻转到该象限的局部方向
+    for (uint32_t s = 1u << 15; s > 0; s >>= 1) {
+        uint32_t rx = (x & s) ? 1 : 0;
+        uint32_t ry = (y & s) ? 1 : 0;
+        code += s * s * ((3 * rx) ^ ry);
+        if (ry == 0) {
+            if (rx == 1) {
+                x = 0xFFFF - x;
+                y = 0xFFFF - y;
+            }
+            std::swap(x, y);
+        }
+    }
+    return code;
+}
+
+void mortonOrder(const double* xs, const double* ys, size_t n, std::vector<uint32_t>& order) {
+    sortAlongCurve(xs, ys, n, order, mortonCode);
+}
+
+void hilbertOrder(const double* xs, const double* ys, size_t n, std::vector<uint32_t>& order) {
+    sortAlongCurve(xs, ys, n, order, hilbertCode);
+}
+
+} // namespace SpaceFillingCurve
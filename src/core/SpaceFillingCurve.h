@@ -0,0 +1,26 @@
+#ifndef SPACE_FILLING_CURVE_H
+#define SPACE_FILLING_CURVE_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// 空间填充曲线：把二维坐标映射到一维序号，序号相近的点在空间上也相近。
+// 用于给批量查询、点的存储顺序等排序，让相邻处理的元素访问相同的数据，提高缓存命中率
+namespace SpaceFillingCurve {
+
+// 把两个16位网格坐标按位交错成32位的 Morton（Z序）码
+uint32_t mortonCode(uint32_t gridX, uint32_t gridY);
+
+// 两个16位网格坐标在16阶 Hilbert 曲线上的序号。Hilbert 曲线上相邻的格子在空间中总是相邻，
+// 局部性比 Morton 序更好（Morton 序在象限之间会跳跃），计算稍慢
+uint32_t hilbertCode(uint32_t gridX, uint32_t gridY);
+
+// 按 Morton / Hilbert 序排列 n 个点：坐标先在它们的包围盒内量化到 65536 x 65536 的网格，
+// order 中写入按曲线顺序排列的下标（码相同时保持原顺序）
+void mortonOrder(const double* xs, const double* ys, size_t n, std::vector<uint32_t>& order);
+void hilbertOrder(const double* xs, const double* ys, size_t n, std::vector<uint32_t>& order);
+
+} // namespace SpaceFillingCurve
+
+#endif // SPACE_FILLING_CURVE_H
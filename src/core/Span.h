@@ -0,0 +1,69 @@
+#ifndef SPAN_H
+#define SPAN_H
+
+#include <cstddef>
+#include <iterator>
+
+// 只读的连续数组视图（C++17下std::span的轻量替代），不分配内存也不拷贝
+// 视图只在底层容器未被修改期间有效
+template<typename T>
+class Span {
+private:
+    const T* ptr;
+    size_t count;
+
+public:
+    Span() : ptr(nullptr), count(0) {}
+    Span(const T* data, size_t size) : ptr(data), count(size) {}
+
+    const T* begin() const { return ptr; }
+    const T* end() const { return ptr + count; }
+    const T* data() const { return ptr; }
+    size_t size() const { return count; }
+    bool empty() const { return count == 0; }
+    const T& operator[](size_t i) const { return ptr[i]; }
+};
+
+// 通过下标数组间接访问的只读视图：第i个元素为 base[indices[i]]
+// indices 为空指针时退化为对 base 的直接视图
+template<typename T>
+class IndexedSpan {
+private:
+    const T* base;
+    const int* indices;
+    size_t count;
+
+public:
+    class Iterator {
+    private:
+        const T* base;
+        const int* indices;
+        size_t pos;
+
+    public:
+        using iterator_category = std::forward_iterator_tag;
+        using value_type = T;
+        using difference_type = std::ptrdiff_t;
+        using pointer = const T*;
+        using reference = const T&;
+
+        Iterator(const T* base, const int* indices, size_t pos) : base(base), indices(indices), pos(pos) {}
+
+        const T& operator*() const { return indices ? base[indices[pos]] : base[pos]; }
+        Iterator& operator++() { ++pos; return *this; }
+        Iterator operator++(int) { Iterator old = *this; ++pos; return old; }
+        bool operator==(const Iterator& other) const { return pos == other.pos; }
+        bool operator!=(const Iterator& other) const { return pos != other.pos; }
+    };
+
+    IndexedSpan() : base(nullptr), indices(nullptr), count(0) {}
+    IndexedSpan(const T* base, const int* indices, size_t size) : base(base), indices(indices), count(size) {}
+
+    Iterator begin() const { return Iterator(base, indices, 0); }
+    Iterator end() const { return Iterator(base, indices, count); }
+    size_t size() const { return count; }
+    bool empty() const { return count == 0; }
+    const T& operator[](size_t i) const { return indices ? base[indices[i]] : base[i]; }
+};
+
+#endif // SPAN_H
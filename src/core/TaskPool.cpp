@@ -0,0 +1,106 @@
+#include "TaskPool.h"
+#include <algorithm>
+
+TaskPool::TaskPool(int numThreads) : stopping(false) {
+    if (numThreads <= 0) {
+        numThreads = static_cast<int>(std::max(1u, std::thread::hardware_concurrency()));
+    }
+    for (int i = 1; i < numThreads; i++) {
+        workers.emplace_back(&TaskPool::workerLoop, this);
+    }
+}
+
+TaskPool::~TaskPool() {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+    }
+    available.notify_all();
+    for (std::thread& worker : workers) {
+        worker.join();
+    }
+}
+
+TaskPool& TaskPool::shared() {
+    static TaskPool pool;
+    return pool;
+}
+
+void TaskPool::submit(std::function<void()> task) {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        queue.push_back(std::move(task));
+    }
+    available.notify_one();
+}
+
+bool TaskPool::runOne() {
+    std::function<void()> task;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (queue.empty()) {
+            return false;
+        }
+        // 从队尾取任务：最近提交的子任务数据最热，也最先能让等待者继续
+        task = std::move(queue.back());
+        queue.pop_back();
+    }
+    task();
+    return true;
+}
+
+void TaskPool::workerLoop() {
+    for (;;) {
+        std::function<void()> task;
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            available.wait(lock, [this] { return stopping || !queue.empty(); });
+            if (queue.empty()) {
+                return; // stopping 且没有剩余任务
+            }
+            // 工作线程从队头取，拿到的是较早提交、通常规模较大的任务
+            task = std::move(queue.front());
+            queue.pop_front();
+        }
+        task();
+    }
+}
+
+void TaskPool::TaskGroup::run(std::function<void()> task) {
+    pending.fetch_add(1, std::memory_order_relaxed);
+    pool.submit([this, task = std::move(task)]() {
+        task();
+        pending.fetch_sub(1, std::memory_order_release);
+    });
+}
+
+void TaskPool::TaskGroup::wait() {
+    while (pending.load(std::memory_order_acquire) > 0) {
+        if (!pool.runOne()) {
+            std::this_thread::yield();
+        }
+    }
+}
+
+void TaskPool::parallelFor(size_t begin, size_t end, size_t grain,
+                           const std::function<void(size_t, size_t)>& body) {
+    if (begin >= end) {
+        return;
+    }
+    size_t total = end - begin;
+    size_t blocks = std::min(total / std::max<size_t>(grain, 1), static_cast<size_t>(getThreadCount()) * 4);
+    if (blocks <= 1) {
+        body(begin, end);
+        return;
+    }
+
+    TaskGroup group(*this);
+    size_t blockSize = (total + blocks - 1) / blocks;
+    for (size_t blockBegin = begin + blockSize; blockBegin < end; blockBegin += blockSize) {
+        size_t blockEnd = std::min(end, blockBegin + blockSize);
+        group.run([&body, blockBegin, blockEnd] { body(blockBegin, blockEnd); });
+    }
+    // 第一块由当前线程执行
+    body(begin, std::min(end, begin + blockSize));
+    group.wait();
+}
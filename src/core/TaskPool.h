@@ -0,0 +1,72 @@
+#ifndef TASK_POOL_H
+#define TASK_POOL_H
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// 固定大小的线程池，用于分治式的并行计算（KD树构建、批量查询等）
+//
+// 任务通过 TaskGroup 提交；等待任务组时，当前线程不会空等，而是继续执行队列中的任务，
+// 所以任务内部可以再创建任务组并等待（递归地分叉子问题），不会因为线程耗尽而死锁
+class TaskPool {
+public:
+    // numThreads 为0时使用硬件线程数；池中启动 numThreads - 1 个工作线程，
+    // 调用者线程在等待时补上最后一个
+    explicit TaskPool(int numThreads = 0);
+    ~TaskPool();
+
+    TaskPool(const TaskPool&) = delete;
+    TaskPool& operator=(const TaskPool&) = delete;
+
+    // 参与计算的线程数（含调用者线程）
+    int getThreadCount() const { return static_cast<int>(workers.size()) + 1; }
+
+    // 一组一起等待的任务
+    class TaskGroup {
+    private:
+        TaskPool& pool;
+        std::atomic<int> pending;
+
+    public:
+        explicit TaskGroup(TaskPool& pool) : pool(pool), pending(0) {}
+        ~TaskGroup() { wait(); }
+
+        TaskGroup(const TaskGroup&) = delete;
+        TaskGroup& operator=(const TaskGroup&) = delete;
+
+        // 提交一个任务
+        void run(std::function<void()> task);
+
+        // 等待所有已提交的任务完成，期间执行队列中的其他任务
+        void wait();
+    };
+
+    // 把 [begin, end) 切成不小于 grain 的块并行执行 body(blockBegin, blockEnd)，全部完成后返回
+    void parallelFor(size_t begin, size_t end, size_t grain,
+                     const std::function<void(size_t, size_t)>& body);
+
+    // 进程内共享的线程池，第一次使用时创建
+    static TaskPool& shared();
+
+private:
+    std::vector<std::thread> workers;
+    std::deque<std::function<void()>> queue;
+    std::mutex mutex;
+    std::condition_variable available;
+    bool stopping;
+
+    void submit(std::function<void()> task);
+
+    // 从队列中取出一个任务执行，队列为空时返回 false
+    bool runOne();
+
+    void workerLoop();
+};
+
+#endif // TASK_POOL_H
@@ -13,6 +13,9 @@
 #include <QSpinBox>     // 添加这行
 #include <random>       // 添加这行
 
+// 按可见范围查询时在四周多取的世界坐标距离，使一端在视野外的道路也能画出
+const double VIEWPORT_QUERY_MARGIN = 100.0;
+
 MainWindow::MainWindow(QWidget *parent)
     : QMainWindow(parent), ui(nullptr) {
 
@@ -69,15 +72,15 @@ void MainWindow::setupUiManual() {
     xCoordInput->setPlaceholderText("X 坐标");
     yCoordInput = new QLineEdit();
     yCoordInput->setPlaceholderText("Y 坐标");
-    showPointsButton = new QPushButton("显示最近的100个点");
-    showAllPointsButton = new QPushButton("显示所有点");
+    showPointsButton = new QPushButton("显示附近的点");
+    showViewportButton = new QPushButton("显示当前视野");
 
     coordInputLayout->addWidget(new QLabel("X:"));
     coordInputLayout->addWidget(xCoordInput);
     coordInputLayout->addWidget(new QLabel("Y:"));
     coordInputLayout->addWidget(yCoordInput);
     coordInputLayout->addWidget(showPointsButton);
-    coordInputLayout->addWidget(showAllPointsButton);
+    coordInputLayout->addWidget(showViewportButton);
     coordInputGroup->setLayout(coordInputLayout);
 
     // 路径查找输入组
@@ -98,6 +101,30 @@ void MainWindow::setupUiManual() {
     pathInputLayout->addWidget(findFastestPathButton); // 新增：添加最快路径按钮到布局
     pathInputGroup->setLayout(pathInputLayout);
 
+    // 按坐标查找路线：起终点吸附到最近的道路上，路线可以从道路中途开始
+    QGroupBox *routeInputGroup = new QGroupBox("按坐标查找路线");
+    QHBoxLayout *routeInputLayout = new QHBoxLayout();
+    routeFromXInput = new QLineEdit();
+    routeFromXInput->setPlaceholderText("起点 X");
+    routeFromYInput = new QLineEdit();
+    routeFromYInput->setPlaceholderText("起点 Y");
+    routeToXInput = new QLineEdit();
+    routeToXInput->setPlaceholderText("终点 X");
+    routeToYInput = new QLineEdit();
+    routeToYInput->setPlaceholderText("终点 Y");
+    QPushButton *findShortestRouteButton = new QPushButton("最短路线");
+    QPushButton *findFastestRouteButton = new QPushButton("最快路线");
+
+    routeInputLayout->addWidget(new QLabel("起点:"));
+    routeInputLayout->addWidget(routeFromXInput);
+    routeInputLayout->addWidget(routeFromYInput);
+    routeInputLayout->addWidget(new QLabel("终点:"));
+    routeInputLayout->addWidget(routeToXInput);
+    routeInputLayout->addWidget(routeToYInput);
+    routeInputLayout->addWidget(findShortestRouteButton);
+    routeInputLayout->addWidget(findFastestRouteButton);
+    routeInputGroup->setLayout(routeInputLayout);
+
     mapWidget = new MapWidget();
     mapWidget->setMinimumSize(600, 400);
 
@@ -116,15 +143,19 @@ void MainWindow::setupUiManual() {
 
     mainLayout->addWidget(coordInputGroup);
     mainLayout->addWidget(pathInputGroup);
+    mainLayout->addWidget(routeInputGroup);
     mainLayout->addWidget(mapControlGroup); // <--- 添加地图控制组
     mainLayout->addWidget(mapWidget, 1);
 
     setCentralWidget(centralWidget);
 
     connect(showPointsButton, &QPushButton::clicked, this, &MainWindow::onShowNearestPointsClicked);
-    connect(showAllPointsButton, &QPushButton::clicked, this, &MainWindow::onShowAllPointsClicked);
+    connect(showViewportButton, &QPushButton::clicked, this, &MainWindow::onShowViewportClicked);
+    connect(mapWidget, &MapWidget::viewChanged, this, &MainWindow::onMapViewChanged); // 平移缩放后按可见范围重新加载
     connect(findPathButton, &QPushButton::clicked, this, &MainWindow::onFindShortestPathClicked);
     connect(findFastestPathButton, &QPushButton::clicked, this, &MainWindow::onFindFastestPathClicked); // 新增：连接最快路径按钮
+    connect(findShortestRouteButton, &QPushButton::clicked, this, &MainWindow::onFindShortestRouteBetweenLocationsClicked);
+    connect(findFastestRouteButton, &QPushButton::clicked, this, &MainWindow::onFindFastestRouteBetweenLocationsClicked);
     connect(zoomSlider, &QSlider::valueChanged, this, &MainWindow::onZoomSliderChanged); // <--- 连接缩放滑块信号
     
     // 创建车流模拟控制面板
@@ -143,6 +174,7 @@ void MainWindow::onShowNearestPointsClicked() {
 
     if (!xOk || !yOk) {
         QMessageBox::warning(this, "输入错误", "请输入有效的数字坐标。");
+        followViewport = false;
         if (mapWidget) { // 修改: mapDisplayWidget -> mapWidget
             mapWidget->clearSpecialPoint(); // 修改: mapDisplayWidget -> mapWidget
             mapWidget->setMapData({}, {});   // 修改: mapDisplayWidget -> mapWidget
@@ -156,7 +188,7 @@ void MainWindow::onShowNearestPointsClicked() {
     }
 
     // 调用 NavigationSystem 获取数据
-    auto mapData = navSystem->getPointsAndRoadsNear(x, y, 100);
+    auto mapData = navSystem->getPointsAndRoadsWithinRadius(x, y, NavigationSystem::NEARBY_RADIUS);
 
     if (mapData.first.empty() && mapWidget) { // 修改: mapDisplayWidget -> mapWidget
         // 即使没有找到附近的点，我们依然希望显示输入的特殊标记点，
@@ -164,31 +196,43 @@ void MainWindow::onShowNearestPointsClicked() {
         QMessageBox::information(this, "提示", "在指定坐标附近未找到任何业务点。输入的坐标点已在地图上标记。");
     }
 
+    followViewport = false; // 只显示附近的点，平移缩放时不重新加载
     if (mapWidget) { // 修改: mapDisplayWidget -> mapWidget
         mapWidget->setMapData(mapData.first, mapData.second); // 修改: mapDisplayWidget -> mapWidget
     }
 }
 
-void MainWindow::onShowAllPointsClicked() {
+void MainWindow::onShowViewportClicked() {
     if (!navSystem || !navSystem->isInitialized()) {
         QMessageBox::warning(this, "错误", "导航系统尚未初始化完毕。请稍后再试。");
         return;
     }
 
-    if (mapWidget) { // 修改: mapDisplayWidget -> mapWidget
-        mapWidget->clearSpecialPoint(); // 修改: mapDisplayWidget -> mapWidget
-        mapWidget->resetView(); // 调用 resetView // 修改: mapDisplayWidget -> mapWidget
+    followViewport = true;
+    if (mapWidget) {
+        mapWidget->clearSpecialPoint();
+        mapWidget->resetView(); // 发出 viewChanged，由 onMapViewChanged 加载可见范围
     }
+}
 
-    auto mapData = navSystem->getAllPointsAndRoads();
-
-    if (mapData.first.empty() && mapWidget) { // 修改: mapDisplayWidget -> mapWidget
-        QMessageBox::information(this, "提示", "地图中没有点可以显示。");
+void MainWindow::onMapViewChanged() {
+    if (followViewport && navSystem && navSystem->isInitialized()) {
+        refreshViewportData();
     }
+}
 
-    if (mapWidget) { // 修改: mapDisplayWidget -> mapWidget
-        mapWidget->setMapData(mapData.first, mapData.second); // 修改: mapDisplayWidget -> mapWidget
+void MainWindow::refreshViewportData() {
+    if (!mapWidget) {
+        return;
     }
+
+    // 只查询可见范围（外加一圈边距）内的点和道路，而不是把整张地图交给控件绘制
+    QRectF visible = mapWidget->visibleWorldRect();
+    auto mapData = navSystem->getPointsAndRoadsInRect(visible.left() - VIEWPORT_QUERY_MARGIN,
+                                                      visible.top() - VIEWPORT_QUERY_MARGIN,
+                                                      visible.right() + VIEWPORT_QUERY_MARGIN,
+                                                      visible.bottom() + VIEWPORT_QUERY_MARGIN);
+    mapWidget->setMapData(mapData.first, mapData.second);
 }
 
 // 新增：处理查找最快路径按钮点击事件的槽函数
@@ -218,6 +262,7 @@ void MainWindow::onFindFastestPathClicked() {
             mapWidget->clearSpecialPoint();
             mapWidget->clearShortestPath();
             mapWidget->clearPathEndpoints(); // 新增：清除路径端点
+            followViewport = false;
             Point* p = navSystem->getPointById(startPointId);
             if (p) {
                  mapWidget->setSpecialPoint(QPointF(p->getX(), p->getY()));
@@ -239,8 +284,8 @@ void MainWindow::onFindFastestPathClicked() {
         if (mapWidget) {
             mapWidget->clearShortestPath(); 
             mapWidget->clearPathEndpoints(); // 新增：清除路径端点
-            auto allMapData = navSystem->getAllPointsAndRoads(); // 重新显示整个地图
-            mapWidget->setMapData(allMapData.first, allMapData.second);
+            followViewport = true; // 按可见范围重新显示地图
+            refreshViewportData();
         }
     } else {
         if (mapWidget) {
@@ -256,16 +301,74 @@ void MainWindow::onFindFastestPathClicked() {
                                            QPointF(endP->getX(), endP->getY()));
             }
             
-            auto allMapData = navSystem->getAllPointsAndRoads(); // 确保整个地图可见，路径会高亮
-            mapWidget->setMapData(allMapData.first, allMapData.second);
+            followViewport = true; // 显示可见范围内的地图，路径会高亮
+            refreshViewportData();
         }
         // 计算并显示预计行驶时间
         // double travelTime = navSystem->pathFinder->calculatePathTravelTime(pathPoints, DEFAULT_C, DEFAULT_THRESHOLD); //  <--- 旧代码
-        double travelTime = navSystem->getPathTravelTime(pathPoints); // <--- 修改后的代码
+        double travelTime = navSystem->getPathTravelTime(pathRoads); // 按搜索选中的道路计算
         QMessageBox::information(this, "路径已找到", QString("最快路径已在地图上高亮显示。\n预计行驶时间: %1").arg(travelTime));
     }
 }
 
+void MainWindow::onFindShortestRouteBetweenLocationsClicked() {
+    findRouteBetweenLocations(false);
+}
+
+void MainWindow::onFindFastestRouteBetweenLocationsClicked() {
+    findRouteBetweenLocations(true);
+}
+
+void MainWindow::findRouteBetweenLocations(bool fastest) {
+    if (!navSystem || !navSystem->isInitialized()) {
+        QMessageBox::warning(this, "错误", "导航系统尚未初始化完毕。请稍后再试。");
+        return;
+    }
+
+    bool fromXOk, fromYOk, toXOk, toYOk;
+    double fromX = routeFromXInput->text().toDouble(&fromXOk);
+    double fromY = routeFromYInput->text().toDouble(&fromYOk);
+    double toX = routeToXInput->text().toDouble(&toXOk);
+    double toY = routeToYInput->text().toDouble(&toYOk);
+
+    if (!fromXOk || !fromYOk || !toXOk || !toYOk) {
+        QMessageBox::warning(this, "输入错误", "请输入有效的数字坐标作为起点和终点。");
+        if (mapWidget) {
+            mapWidget->clearShortestPath();
+            mapWidget->clearPathEndpoints();
+        }
+        return;
+    }
+
+    LocationRoute route = fastest ? navSystem->getFastestPathBetweenLocations(fromX, fromY, toX, toY)
+                                  : navSystem->getShortestPathBetweenLocations(fromX, fromY, toX, toY);
+
+    if (!route.found) {
+        QMessageBox::information(this, "路线未找到", "无法找到两个坐标之间的路线。");
+        if (mapWidget) {
+            mapWidget->clearShortestPath();
+            mapWidget->clearPathEndpoints();
+        }
+        return;
+    }
+
+    if (mapWidget) {
+        mapWidget->clearSpecialPoint();
+        mapWidget->clearShortestPath();
+        mapWidget->setShortestPathData(route.points, route.roads);
+        // 端点画在吸附后的道路位置上，而不是最近的路口
+        mapWidget->setPathEndpoints(QPointF(route.fromX, route.fromY), QPointF(route.toX, route.toY));
+        followViewport = true;
+        refreshViewportData();
+    }
+
+    if (fastest) {
+        QMessageBox::information(this, "路线已找到", QString("最快路线已在地图上高亮显示。\n预计行驶时间: %1").arg(route.cost));
+    } else {
+        QMessageBox::information(this, "路线已找到", QString("最短路线已在地图上高亮显示。\n路线长度: %1").arg(route.cost));
+    }
+}
+
 void MainWindow::onAddCarClicked() {
     if (!navSystem || !navSystem->isInitialized()) {
         QMessageBox::warning(this, "错误", "导航系统尚未初始化完毕。请稍后再试。");
@@ -407,6 +510,7 @@ void MainWindow::onShowMapClicked() {
 
     if (!xOk || !yOk) {
         QMessageBox::warning(this, "输入错误", "请输入有效的数字坐标。");
+        followViewport = false;
         if (mapWidget) {
             mapWidget->clearSpecialPoint();
             mapWidget->setMapData({}, {});
@@ -418,9 +522,10 @@ void MainWindow::onShowMapClicked() {
     navSystem->showMapAroundLocation(x, y);
     
     // 设置特殊标记点
+    followViewport = false;
     if (mapWidget) {
         mapWidget->setSpecialPoint(QPointF(x, y));
-        auto mapData = navSystem->getPointsAndRoadsNear(x, y, 100);
+        auto mapData = navSystem->getPointsAndRoadsWithinRadius(x, y, NavigationSystem::NEARBY_RADIUS);
         mapWidget->setMapData(mapData.first, mapData.second);
     }
 }
@@ -476,6 +581,7 @@ void MainWindow::onFindShortestPathClicked() {
             mapWidget->clearSpecialPoint();
             mapWidget->clearShortestPath();
             mapWidget->clearPathEndpoints(); // 新增：清除路径端点
+            followViewport = false;
             Point* p = navSystem->getPointById(startPointId);
             if (p) {
                  mapWidget->setSpecialPoint(QPointF(p->getX(), p->getY()));
@@ -497,8 +603,8 @@ void MainWindow::onFindShortestPathClicked() {
         if (mapWidget) {
             mapWidget->clearShortestPath(); 
             mapWidget->clearPathEndpoints(); // 新增：清除路径端点
-            auto allMapData = navSystem->getAllPointsAndRoads(); // 重新显示整个地图
-            mapWidget->setMapData(allMapData.first, allMapData.second);
+            followViewport = true; // 按可见范围重新显示地图
+            refreshViewportData();
         }
     } else {
         if (mapWidget) {
@@ -514,8 +620,8 @@ void MainWindow::onFindShortestPathClicked() {
                                            QPointF(endP->getX(), endP->getY()));
             }
             
-            auto allMapData = navSystem->getAllPointsAndRoads(); // 确保整个地图可见，路径会高亮
-            mapWidget->setMapData(allMapData.first, allMapData.second);
+            followViewport = true; // 显示可见范围内的地图，路径会高亮
+            refreshViewportData();
         }
         QMessageBox::information(this, "路径已找到", "最短路径已在地图上高亮显示。");
     }
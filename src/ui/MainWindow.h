@@ -25,9 +25,12 @@ public:
 private slots:
     void onShowMapClicked(); // 这个槽函数已声明，但错误信息中提到的是 onShowNearestPointsClicked
     void onShowNearestPointsClicked(); // <--- 新增：声明 onShowNearestPointsClicked
-    void onShowAllPointsClicked();   // <--- 新增：声明 onShowAllPointsClicked
+    void onShowViewportClicked();    // 重置视图并显示可见范围内的点和道路
+    void onMapViewChanged();         // 地图平移/缩放后按可见范围重新加载
     void onFindShortestPathClicked();
     void onFindFastestPathClicked(); 
+    void onFindShortestRouteBetweenLocationsClicked(); // 按坐标查找最短路线（起终点吸附到道路上）
+    void onFindFastestRouteBetweenLocationsClicked();  // 按坐标查找最快路线
     void onAddCarClicked();
     void onSimulateTrafficClicked();
     void onZoomSliderChanged(int value); 
@@ -47,13 +50,19 @@ private:
     QLineEdit *xCoordInput;
     QLineEdit *yCoordInput;
     QPushButton *showPointsButton;
-    QPushButton *showAllPointsButton; // 新增按钮
+    QPushButton *showViewportButton; // 显示当前视野
 
     // 新增：用于路径查找的UI元素
     QLineEdit *startPointInput;
     QLineEdit *endPointInput;
     QPushButton *findPathButton;
 
+    // 按坐标查找路线的输入框，起终点可以在道路中途
+    QLineEdit *routeFromXInput;
+    QLineEdit *routeFromYInput;
+    QLineEdit *routeToXInput;
+    QLineEdit *routeToYInput;
+
     // 新增：地图缩放滑块
     QSlider* zoomSlider; // <--- 新增
 
@@ -82,6 +91,15 @@ private:
     // 新增：手动设置UI的函数声明
     void setupUiManual(); // <--- 添加这一行
     
+    // 按地图控件的可见范围查询点和道路并显示
+    void refreshViewportData();
+    
+    // 读取坐标输入框，查找两坐标之间的最短（fastest 为 false）或最快路线并显示
+    void findRouteBetweenLocations(bool fastest);
+    
+    // 为 true 时地图显示跟随视图的可见范围，平移缩放后重新查询；显示附近点等局部结果时为 false
+    bool followViewport = false;
+    
     NavigationSystem* navSystem;
     MapWidget* mapWidget;
 }; // <-- 添加分号
@@ -56,8 +56,7 @@ void MapRenderer::renderNearLocation(double x, double y, const std::vector<Point
     std::unordered_set<int> roadIds; // 用于避免重复显示道路
     
     for (auto point : nearPoints) {
-        auto roads = map->getRoadsFromPoint(point->getId());
-        for (auto road : roads) {
+        for (Road* road : map->roadsFromPointView(point->getId())) {
             // 检查道路的另一端是否也在最近的点中
             Point* otherEnd = (road->getStartPoint()->getId() == point->getId()) ? 
                               road->getEndPoint() : road->getStartPoint();
@@ -2,6 +2,7 @@
 #include <QPainter>
 #include <QMouseEvent> // For QMouseEvent and QWheelEvent
 #include <QWheelEvent> // For QWheelEvent
+#include <QResizeEvent>
 
 MapWidget::MapWidget(QWidget *parent) : QWidget(parent), hasSpecialMarkedPoint(false) { // 初始化新增的成员变量
     // 背景设为白色，方便观察
@@ -36,7 +37,8 @@ void MapWidget::clearSpecialPoint() {
 void MapWidget::setShortestPathData(const std::vector<Point*>& pathPoints, const std::vector<Road*>& pathRoads) {
     this->pathPoints = pathPoints; // 修改: shortestPathPoints -> this->pathPoints
     this->pathRoads = pathRoads;   // 修改: shortestPathRoads -> this->pathRoads
-    hasShortestPath = !this->pathPoints.empty() && !this->pathRoads.empty(); // 确保使用成员变量
+    // 按坐标查找的路线在同一条道路上时没有途经路口，只要有道路就显示
+    hasShortestPath = !this->pathRoads.empty(); // 确保使用成员变量
     update(); // 请求重绘以显示路径
 }
 
@@ -55,6 +57,7 @@ void MapWidget::resetView() {
     // 你可能还需要根据所有点的位置计算一个合适的初始缩放和中心点
     // 这里简单重置为默认
     update();
+    emit viewChanged();
 }
 
 // 新增：设置缩放因子的方法
@@ -71,6 +74,14 @@ void MapWidget::setZoomFactor(double factor) {
 
     scaleFactor = factor;
     update(); // 请求重绘
+    emit viewChanged();
+}
+
+QRectF MapWidget::visibleWorldRect() const {
+    // paintEvent 先平移 panOffset 再缩放 scaleFactor，屏幕坐标 s 对应世界坐标 (s - panOffset) / scaleFactor
+    QPointF topLeft = (QPointF(0, 0) - panOffset) / scaleFactor;
+    QPointF bottomRight = (QPointF(width(), height()) - panOffset) / scaleFactor;
+    return QRectF(topLeft, bottomRight);
 }
 
 void MapWidget::setTrafficSimulator(TrafficSimulator* simulator) {
@@ -197,22 +208,12 @@ void MapWidget::paintEvent(QPaintEvent *event) {
         painter.drawEllipse(this->specialPoint, 5, 5); // 修改: specialMarkedPoint -> this->specialPoint
     }
     
-    // 绘制路径的起点和终点 (红色)
-    if (hasPathEndpoints && hasShortestPath && !this->pathPoints.empty()) {
+    // 绘制路径的起点和终点 (红色)，按坐标查找的路线端点可以在道路中途
+    if (hasPathEndpoints && hasShortestPath) {
         painter.setPen(QPen(Qt::black, 1));
         painter.setBrush(Qt::red);
-        
-        // 绘制起点 (如果有)
-        if (!this->pathPoints.empty()) {
-            Point* startPoint = this->pathPoints.front();
-            painter.drawEllipse(QPointF(startPoint->getX(), startPoint->getY()), 6, 6);
-        }
-        
-        // 绘制终点 (如果有)
-        if (this->pathPoints.size() > 1) {
-            Point* endPoint = this->pathPoints.back();
-            painter.drawEllipse(QPointF(endPoint->getX(), endPoint->getY()), 6, 6);
-        }
+        painter.drawEllipse(pathStartPoint, 6, 6);
+        painter.drawEllipse(pathEndPoint, 6, 6);
     }
     
     // 如果有交通模拟器，绘制车辆位置
@@ -240,6 +241,7 @@ void MapWidget::mouseMoveEvent(QMouseEvent *event) {
         panOffset += delta;
         lastMousePos = event->pos();
         update();
+        emit viewChanged();
     }
 }
 
@@ -256,4 +258,10 @@ void MapWidget::wheelEvent(QWheelEvent *event) {
 
     scaleFactor *= zoomFactor;
     update();
+    emit viewChanged();
+}
+
+void MapWidget::resizeEvent(QResizeEvent *event) {
+    QWidget::resizeEvent(event);
+    emit viewChanged();
 }
@@ -30,6 +30,12 @@ public:
     void setPathEndpoints(const QPointF& start, const QPointF& end);
     // 新增：清除路径端点
     void clearPathEndpoints();
+    // 当前视图可见的世界坐标范围（由平移、缩放和控件大小决定）
+    QRectF visibleWorldRect() const;
+
+signals:
+    // 平移、缩放、重置视图或控件大小改变后发出，用于按可见范围重新加载地图数据
+    void viewChanged();
 
 protected:
     void paintEvent(QPaintEvent *event) override;
@@ -37,6 +43,7 @@ protected:
     void mousePressEvent(QMouseEvent *event) override;
     void mouseMoveEvent(QMouseEvent *event) override;
     void wheelEvent(QWheelEvent *event) override;
+    void resizeEvent(QResizeEvent *event) override;
 
 private:
     std::vector<Point*> displayPoints;